@@ -0,0 +1,47 @@
+#include "lfs_countbd.h"
+
+#include <string.h>
+
+void lfs_countbd_wrap(lfs_countbd_t* bd, struct lfs_config* config) {
+  bd->bd_config = *config;
+  lfs_countbd_reset(bd);
+
+  config->context = bd;
+  config->read = lfs_countbd_read;
+  config->prog = lfs_countbd_prog;
+  config->erase = lfs_countbd_erase;
+  config->sync = lfs_countbd_sync;
+}
+
+void lfs_countbd_reset(lfs_countbd_t* bd) {
+  memset(&bd->stats, 0, sizeof(bd->stats));
+}
+
+int lfs_countbd_read(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                     void* buffer, lfs_size_t size) {
+  lfs_countbd_t* bd = config->context;
+  bd->stats.reads++;
+  bd->stats.read_bytes += size;
+  return bd->bd_config.read(&bd->bd_config, block, off, buffer, size);
+}
+
+int lfs_countbd_prog(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                     const void* buffer, lfs_size_t size) {
+  lfs_countbd_t* bd = config->context;
+  bd->stats.progs++;
+  bd->stats.prog_bytes += size;
+  return bd->bd_config.prog(&bd->bd_config, block, off, buffer, size);
+}
+
+int lfs_countbd_erase(const struct lfs_config* config, lfs_block_t block) {
+  lfs_countbd_t* bd = config->context;
+  bd->stats.erases++;
+  bd->stats.erase_bytes += config->block_size;
+  return bd->bd_config.erase(&bd->bd_config, block);
+}
+
+int lfs_countbd_sync(const struct lfs_config* config) {
+  lfs_countbd_t* bd = config->context;
+  bd->stats.syncs++;
+  return bd->bd_config.sync(&bd->bd_config);
+}
@@ -0,0 +1,75 @@
+#ifndef LFS_COUNTBD_H
+#define LFS_COUNTBD_H
+
+#include <lfs.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of block device operations and the number of bytes that they
+ * moved.
+ */
+typedef struct {
+  uint64_t reads;
+  uint64_t progs;
+  uint64_t erases;
+  uint64_t syncs;
+  uint64_t read_bytes;
+  uint64_t prog_bytes;
+  uint64_t erase_bytes;
+} lfs_countbd_stats_t;
+
+/**
+ * A block device that forwards all operations to another block device and
+ * counts them.
+ */
+typedef struct {
+  /**
+   * A copy of the configuration of the underlying block device.
+   */
+  struct lfs_config bd_config;
+  lfs_countbd_stats_t stats;
+} lfs_countbd_t;
+
+/**
+ * Inserts a counting block device in front of the block device that the given
+ * littlefs configuration refers to.
+ *
+ * Afterwards, the configuration refers to the counting block device. The
+ * underlying block device must still be destroyed using its own configuration,
+ * i.e., bd->bd_config.
+ *
+ * @param bd the counting block device
+ * @param config the littlefs configuration, which is modified
+ */
+void lfs_countbd_wrap(lfs_countbd_t* bd, struct lfs_config* config);
+
+/**
+ * Resets all counters to zero.
+ *
+ * In order to attribute block device operations to a single function call,
+ * reset the counters before the call and read them afterwards.
+ *
+ * @param bd the counting block device
+ */
+void lfs_countbd_reset(lfs_countbd_t* bd);
+
+int lfs_countbd_read(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                     void* buffer, lfs_size_t size);
+
+int lfs_countbd_prog(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                     const void* buffer, lfs_size_t size);
+
+int lfs_countbd_erase(const struct lfs_config* config, lfs_block_t block);
+
+int lfs_countbd_sync(const struct lfs_config* config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LFS_COUNTBD_H
@@ -0,0 +1,118 @@
+#include "lfs_simbd.h"
+
+// Program times are typical values from data sheets. Read and transfer times
+// assume a 50 MHz quad SPI bus (NOR), a 40 MB/s bus (NAND), and a 25 MHz SPI
+// bus (SD).
+
+const struct lfs_simbd_profile lfs_simbd_spi_nor = {
+  .name = "spi_nor",
+  .read_size = 1,
+  .prog_size = 1,
+  .page_size = 256,
+  .block_size = 4096,
+  .read_call_ns = 1000,
+  .read_page_ns = 0,
+  .read_byte_ns = 40,
+  .prog_call_ns = 1000,
+  .prog_page_ns = 700000,
+  .prog_byte_ns = 40,
+  .erase_block_ns = 45000000,
+  .sync_ns = 0
+};
+
+const struct lfs_simbd_profile lfs_simbd_nand = {
+  .name = "nand",
+  .read_size = 2048,
+  .prog_size = 2048,
+  .page_size = 2048,
+  .block_size = 128 * 1024,
+  .read_call_ns = 0,
+  .read_page_ns = 25000,
+  .read_byte_ns = 25,
+  .prog_call_ns = 0,
+  .prog_page_ns = 250000,
+  .prog_byte_ns = 25,
+  .erase_block_ns = 2000000,
+  .sync_ns = 0
+};
+
+const struct lfs_simbd_profile lfs_simbd_sd = {
+  .name = "sd",
+  .read_size = 512,
+  .prog_size = 512,
+  .page_size = 512,
+  .block_size = 512,
+  .read_call_ns = 100000,
+  .read_page_ns = 0,
+  .read_byte_ns = 320,
+  .prog_call_ns = 100000,
+  .prog_page_ns = 1000000,
+  .prog_byte_ns = 320,
+  // SD cards erase internally when writing.
+  .erase_block_ns = 0,
+  .sync_ns = 2000000
+};
+
+int lfs_simbd_wrap(lfs_simbd_t* bd, struct lfs_config* config,
+                   const struct lfs_simbd_profile* profile) {
+  if (config->read_size % profile->read_size != 0 ||
+      config->prog_size % profile->prog_size != 0 ||
+      config->block_size % profile->block_size != 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  bd->bd_config = *config;
+  bd->profile = profile;
+  bd->now_ns = 0;
+
+  config->context = bd;
+  config->read = lfs_simbd_read;
+  config->prog = lfs_simbd_prog;
+  config->erase = lfs_simbd_erase;
+  config->sync = lfs_simbd_sync;
+  return 0;
+}
+
+// Returns the number of pages that the given byte range touches.
+static uint64_t count_pages(const lfs_simbd_t* bd, lfs_block_t block, lfs_off_t off,
+                            lfs_size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  uint64_t start = (uint64_t) block * bd->bd_config.block_size + off;
+  uint64_t end = start + size - 1;
+  return end / bd->profile->page_size - start / bd->profile->page_size + 1;
+}
+
+int lfs_simbd_read(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                   void* buffer, lfs_size_t size) {
+  lfs_simbd_t* bd = config->context;
+  const struct lfs_simbd_profile* p = bd->profile;
+  LFS_ASSERT(off % p->read_size == 0 && size % p->read_size == 0);
+  bd->now_ns += p->read_call_ns + count_pages(bd, block, off, size) * p->read_page_ns +
+                (uint64_t) size * p->read_byte_ns;
+  return bd->bd_config.read(&bd->bd_config, block, off, buffer, size);
+}
+
+int lfs_simbd_prog(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                   const void* buffer, lfs_size_t size) {
+  lfs_simbd_t* bd = config->context;
+  const struct lfs_simbd_profile* p = bd->profile;
+  LFS_ASSERT(off % p->prog_size == 0 && size % p->prog_size == 0);
+  bd->now_ns += p->prog_call_ns + count_pages(bd, block, off, size) * p->prog_page_ns +
+                (uint64_t) size * p->prog_byte_ns;
+  return bd->bd_config.prog(&bd->bd_config, block, off, buffer, size);
+}
+
+int lfs_simbd_erase(const struct lfs_config* config, lfs_block_t block) {
+  lfs_simbd_t* bd = config->context;
+  const struct lfs_simbd_profile* p = bd->profile;
+  bd->now_ns += (uint64_t) (config->block_size / p->block_size) * p->erase_block_ns;
+  return bd->bd_config.erase(&bd->bd_config, block);
+}
+
+int lfs_simbd_sync(const struct lfs_config* config) {
+  lfs_simbd_t* bd = config->context;
+  bd->now_ns += bd->profile->sync_ns;
+  return bd->bd_config.sync(&bd->bd_config);
+}
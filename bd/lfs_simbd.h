@@ -0,0 +1,103 @@
+#ifndef LFS_SIMBD_H
+#define LFS_SIMBD_H
+
+#include <lfs.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The geometry and timing characteristics of a type of memory.
+ *
+ * Each operation costs a fixed amount of time per call, per page that it
+ * touches, and per byte that is transferred. Erasing costs a fixed amount of
+ * time per block.
+ */
+struct lfs_simbd_profile {
+  const char* name;
+
+  lfs_size_t read_size;
+  lfs_size_t prog_size;
+  lfs_size_t page_size;
+  lfs_size_t block_size;
+
+  uint32_t read_call_ns;
+  uint32_t read_page_ns;
+  uint32_t read_byte_ns;
+
+  uint32_t prog_call_ns;
+  uint32_t prog_page_ns;
+  uint32_t prog_byte_ns;
+
+  uint32_t erase_block_ns;
+  uint32_t sync_ns;
+};
+
+/**
+ * A typical serial NOR flash with 4 KiB sectors, such as W25Q-series chips.
+ */
+extern const struct lfs_simbd_profile lfs_simbd_spi_nor;
+
+/**
+ * A typical raw SLC NAND flash with 2 KiB pages and 128 KiB blocks.
+ */
+extern const struct lfs_simbd_profile lfs_simbd_nand;
+
+/**
+ * A typical SD card that is accessed in SPI mode.
+ */
+extern const struct lfs_simbd_profile lfs_simbd_sd;
+
+/**
+ * A block device that forwards all operations to another block device, and
+ * advances a virtual clock by the time that each operation would take on the
+ * simulated memory.
+ */
+typedef struct {
+  /**
+   * A copy of the configuration of the underlying block device.
+   */
+  struct lfs_config bd_config;
+  const struct lfs_simbd_profile* profile;
+  /**
+   * The virtual time in nanoseconds.
+   */
+  uint64_t now_ns;
+} lfs_simbd_t;
+
+/**
+ * Inserts a simulated block device in front of the block device that the given
+ * littlefs configuration refers to.
+ *
+ * The geometry of the littlefs configuration must match the profile, i.e., the
+ * read, prog, and block sizes of the configuration must be multiples of those
+ * of the profile. Afterwards, the configuration refers to the simulated block
+ * device. The underlying block device must still be destroyed using its own
+ * configuration, i.e., bd->bd_config.
+ *
+ * @param bd the simulated block device
+ * @param config the littlefs configuration, which is modified
+ * @param profile the memory to simulate
+ * @return 0 on success, or LFS_ERR_INVAL if the geometry does not match
+ */
+int lfs_simbd_wrap(lfs_simbd_t* bd, struct lfs_config* config,
+                   const struct lfs_simbd_profile* profile);
+
+int lfs_simbd_read(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                   void* buffer, lfs_size_t size);
+
+int lfs_simbd_prog(const struct lfs_config* config, lfs_block_t block, lfs_off_t off,
+                   const void* buffer, lfs_size_t size);
+
+int lfs_simbd_erase(const struct lfs_config* config, lfs_block_t block);
+
+int lfs_simbd_sync(const struct lfs_config* config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LFS_SIMBD_H
@@ -0,0 +1,447 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <lfs_ringbuffer.h>
+
+#include <lfs_countbd.h>
+#include <lfs_rambd.h>
+#include <lfs_simbd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LFS_READ_SIZE      16
+#define LFS_BLOCK_SIZE     4096
+#define LFS_BLOCK_CYCLES   (-1)
+#define LFS_LOOKAHEAD_SIZE 16
+
+// The size of the file system.
+#define BENCH_FS_SIZE      (4 * 1024 * 1024)
+
+// The parameters of a single benchmark run. Without a profile, the block device
+// is not simulated and latencies are measured in real time.
+struct bench_params {
+  const struct lfs_simbd_profile* profile;
+  enum lfsring_mode mode;
+  enum lfsring_write_mode write_mode;
+  lfs_size_t object_size;
+  lfs_size_t file_size;
+  lfs_size_t read_size;
+  lfs_size_t prog_size;
+  lfs_size_t block_size;
+  lfs_size_t cache_size;
+};
+
+// The block devices that are stacked on top of the in-memory block device.
+struct bench_env {
+  const struct bench_params* params;
+  lfs_countbd_t countbd;
+  lfs_simbd_t simbd;
+};
+
+// The latencies (in nanoseconds) and block device operations of all calls to a
+// single function.
+struct bench_samples {
+  const char* op;
+  uint64_t* latencies;
+  size_t n;
+  size_t cap;
+  uint64_t total_ns;
+  uint64_t total_bytes;
+  lfs_countbd_stats_t io;
+};
+
+enum bench_op { BENCH_APPEND, BENCH_PEEK, BENCH_TAKE, BENCH_DROP, BENCH_N_OPS };
+
+static const char* mode_names[] = {
+  [LFSRING_MODE_STREAM] = "stream",
+  [LFSRING_MODE_OBJECT] = "object",
+  [LFSRING_MODE_FIXED] = "fixed"
+};
+
+static const char* write_mode_names[] = {
+  [LFSRING_NO_OVERWRITE] = "no_overwrite",
+  [LFSRING_OVERWRITE] = "overwrite"
+};
+
+// Aborts the benchmark. Benchmarks are built with NDEBUG, so errors must not be
+// checked using assert.
+static void fail(const char* what, int err) {
+  fprintf(stderr, "%s failed: %d\n", what, err);
+  exit(1);
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  int err = clock_gettime(CLOCK_MONOTONIC, &ts);
+  if (err) {
+    fail("clock_gettime", err);
+  }
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+// Returns the virtual time of the simulated block device, if any, or the real
+// time otherwise.
+static uint64_t bench_now(const struct bench_env* env) {
+  return env->params->profile ? env->simbd.now_ns : now_ns();
+}
+
+// Starts measuring a single call.
+static uint64_t begin(struct bench_env* env) {
+  lfs_countbd_reset(&env->countbd);
+  return bench_now(env);
+}
+
+// Records the latency and the block device operations of a single call.
+static void record(struct bench_samples* s, struct bench_env* env, uint64_t start,
+                   lfs_size_t bytes) {
+  uint64_t ns = bench_now(env) - start;
+  const lfs_countbd_t* bd = &env->countbd;
+
+  s->io.reads += bd->stats.reads;
+  s->io.progs += bd->stats.progs;
+  s->io.erases += bd->stats.erases;
+  s->io.syncs += bd->stats.syncs;
+  s->io.read_bytes += bd->stats.read_bytes;
+  s->io.prog_bytes += bd->stats.prog_bytes;
+  s->io.erase_bytes += bd->stats.erase_bytes;
+
+  if (s->n == s->cap) {
+    s->cap = s->cap ? 2 * s->cap : 256;
+    uint64_t* latencies = realloc(s->latencies, s->cap * sizeof(*s->latencies));
+    if (latencies == NULL) {
+      fail("realloc", 0);
+    }
+    s->latencies = latencies;
+  }
+  s->latencies[s->n++] = ns;
+  s->total_ns += ns;
+  s->total_bytes += bytes;
+}
+
+static int compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+  return (x > y) - (x < y);
+}
+
+// Returns the p-th percentile (nearest rank) of sorted latencies.
+static uint64_t percentile(const struct bench_samples* s, unsigned int p) {
+  if (s->n == 0) {
+    return 0;
+  }
+  size_t rank = (s->n * p + 99) / 100;
+  return s->latencies[rank == 0 ? 0 : rank - 1];
+}
+
+static void report(const struct bench_params* p, struct bench_samples* s, bool json, bool* first) {
+  qsort(s->latencies, s->n, sizeof(*s->latencies), compare_u64);
+
+  double secs = s->total_ns / 1e9;
+  double ops_per_sec = (secs > 0) ? s->n / secs : 0;
+  double bytes_per_sec = (secs > 0) ? s->total_bytes / secs : 0;
+
+  // Block device operations per call, and erases per KiB of objects, which
+  // determines the lifetime of the flash memory.
+  double n = s->n ? (double) s->n : 1;
+  double kib = s->total_bytes ? s->total_bytes / 1024.0 : 1;
+  double reads = s->io.reads / n, progs = s->io.progs / n, erases = s->io.erases / n;
+  double syncs = s->io.syncs / n, read_bytes = s->io.read_bytes / n;
+  double prog_bytes = s->io.prog_bytes / n, erases_per_kib = s->io.erases / kib;
+
+  if (json) {
+    printf("%s\n  {\"profile\": \"%s\", \"mode\": \"%s\", \"write_mode\": \"%s\", \"object_size\": %u, "
+           "\"file_size\": %u, \"prog_size\": %u, \"cache_size\": %u, \"op\": \"%s\", "
+           "\"ops\": %zu, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+           "\"p50_ns\": %llu, \"p99_ns\": %llu, \"reads_per_op\": %.2f, "
+           "\"progs_per_op\": %.2f, \"erases_per_op\": %.2f, \"syncs_per_op\": %.2f, "
+           "\"read_bytes_per_op\": %.1f, \"prog_bytes_per_op\": %.1f, \"erases_per_kib\": %.3f}",
+           *first ? "" : ",", p->profile ? p->profile->name : "ram", mode_names[p->mode], write_mode_names[p->write_mode],
+           p->object_size, p->file_size, p->prog_size, p->cache_size, s->op, s->n,
+           ops_per_sec, bytes_per_sec, (unsigned long long) percentile(s, 50),
+           (unsigned long long) percentile(s, 99), reads, progs, erases, syncs, read_bytes,
+           prog_bytes, erases_per_kib);
+  } else {
+    printf("%s,%s,%s,%u,%u,%u,%u,%s,%zu,%.1f,%.1f,%llu,%llu,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.3f\n",
+           p->profile ? p->profile->name : "ram", mode_names[p->mode],
+           write_mode_names[p->write_mode], p->object_size, p->file_size, p->prog_size, p->cache_size, s->op, s->n, ops_per_sec,
+           bytes_per_sec, (unsigned long long) percentile(s, 50),
+           (unsigned long long) percentile(s, 99), reads, progs, erases, syncs, read_bytes,
+           prog_bytes, erases_per_kib);
+  }
+  *first = false;
+}
+
+// Removes the oldest object (or, in stream mode, object_size bytes).
+static void timed_drop(lfsring_t* ring, struct bench_env* env, struct bench_samples* s) {
+  const struct bench_params* p = env->params;
+  lfs_off_t n = (p->mode == LFSRING_MODE_STREAM) ? p->object_size : 1;
+  uint64_t start = begin(env);
+  int err = lfsring_drop(ring, n);
+  record(s, env, start, p->object_size);
+  if (err) {
+    fail("lfsring_drop", err);
+  }
+}
+
+static void run_bench(const struct bench_params* p, unsigned int iterations,
+                      struct bench_samples samples[BENCH_N_OPS]) {
+  lfs_size_t block_count = BENCH_FS_SIZE / p->block_size;
+
+  lfs_rambd_t rambd;
+  struct lfs_config fs_config = {
+    .context        = &rambd,
+    .read           = lfs_rambd_read,
+    .prog           = lfs_rambd_prog,
+    .erase          = lfs_rambd_erase,
+    .sync           = lfs_rambd_sync,
+    .read_size      = p->read_size,
+    .prog_size      = p->prog_size,
+    .block_size     = p->block_size,
+    .block_count    = block_count,
+    .block_cycles   = LFS_BLOCK_CYCLES,
+    .cache_size     = p->cache_size,
+    .lookahead_size = LFS_LOOKAHEAD_SIZE
+  };
+
+  struct lfs_rambd_config rambd_config = {
+#if LFS_VERSION < 0x00020006
+    .erase_value = 0,
+#elif LFS_VERSION >= 0x00020008
+    .read_size = p->read_size,
+    .prog_size = p->prog_size,
+    .erase_size = p->block_size,
+    .erase_count = block_count,
+#endif
+    .buffer = NULL
+  };
+
+#if LFS_VERSION >= 0x00020008
+  int err = lfs_rambd_create(&fs_config, &rambd_config);
+#else
+  int err = lfs_rambd_createcfg(&fs_config, &rambd_config);
+#endif
+  if (err) {
+    fail("lfs_rambd_create", err);
+  }
+
+  struct bench_env env = { .params = p };
+  const struct lfs_config* rambd_fs_config = &env.countbd.bd_config;
+  if (p->profile) {
+    err = lfs_simbd_wrap(&env.simbd, &fs_config, p->profile);
+    if (err) {
+      fail("lfs_simbd_wrap", err);
+    }
+    rambd_fs_config = &env.simbd.bd_config;
+  }
+  lfs_countbd_wrap(&env.countbd, &fs_config);
+
+  lfs_t fs;
+  err = lfs_format(&fs, &fs_config);
+  if (err) {
+    fail("lfs_format", err);
+  }
+  err = lfs_mount(&fs, &fs_config);
+  if (err) {
+    fail("lfs_mount", err);
+  }
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = p->mode,
+    .record_size = p->object_size,
+    .file_size = p->file_size
+  };
+
+  lfsring_t ring;
+  err = lfsring_open(&ring, &fs, "bench.cb", &config);
+  if (err) {
+    fail("lfsring_open", err);
+  }
+
+  uint8_t* data = malloc(p->object_size);
+  if (data == NULL) {
+    fail("malloc", 0);
+  }
+  memset(data, 0xa5, p->object_size);
+
+  // Append objects. Without overwriting, the oldest object is dropped whenever
+  // the ring buffer is full, so both phases reflect the steady state.
+  for (unsigned int i = 0; i < iterations; i++) {
+    uint64_t start = begin(&env);
+    err = lfsring_append(&ring, data, p->object_size, p->write_mode);
+    if (err == LFS_ERR_NOSPC && p->write_mode == LFSRING_NO_OVERWRITE) {
+      timed_drop(&ring, &env, &samples[BENCH_DROP]);
+      start = begin(&env);
+      err = lfsring_append(&ring, data, p->object_size, p->write_mode);
+    }
+    record(&samples[BENCH_APPEND], &env, start, p->object_size);
+    if (err) {
+      fail("lfsring_append", err);
+    }
+  }
+
+  // Read everything back. Every call must make progress, otherwise the loops
+  // would never end.
+  while (!lfsring_is_empty(&ring)) {
+    uint64_t start = begin(&env);
+    lfs_ssize_t ret = lfsring_peek(&ring, data, p->object_size);
+    record(&samples[BENCH_PEEK], &env, start, ret);
+    if (ret <= 0) {
+      fail("lfsring_peek", ret);
+    }
+
+    start = begin(&env);
+    ret = lfsring_take(&ring, data, p->object_size);
+    record(&samples[BENCH_TAKE], &env, start, ret);
+    if (ret <= 0) {
+      fail("lfsring_take", ret);
+    }
+  }
+
+  // Fill the ring buffer once more and drop everything.
+  while ((err = lfsring_append(&ring, data, p->object_size, LFSRING_NO_OVERWRITE)) == 0);
+  if (err != LFS_ERR_NOSPC) {
+    fail("lfsring_append", err);
+  }
+  while (!lfsring_is_empty(&ring)) {
+    timed_drop(&ring, &env, &samples[BENCH_DROP]);
+  }
+
+  free(data);
+
+  err = lfsring_close(&ring);
+  if (err) {
+    fail("lfsring_close", err);
+  }
+  err = lfs_unmount(&fs);
+  if (err) {
+    fail("lfs_unmount", err);
+  }
+  err = lfs_rambd_destroy(rambd_fs_config);
+  if (err) {
+    fail("lfs_rambd_destroy", err);
+  }
+}
+
+int main(int argc, char** argv) {
+  static const struct lfs_simbd_profile* profiles[] = {
+    &lfs_simbd_spi_nor, &lfs_simbd_nand, &lfs_simbd_sd
+  };
+
+  bool json = false;
+  unsigned int iterations = 1000;
+  const struct lfs_simbd_profile* profile = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      const char* name = argv[++i];
+      profile = NULL;
+      for (size_t j = 0; j < sizeof(profiles) / sizeof(profiles[0]); j++) {
+        if (strcmp(profiles[j]->name, name) == 0) {
+          profile = profiles[j];
+        }
+      }
+      if (profile == NULL && strcmp(name, "ram") != 0) {
+        fprintf(stderr, "unknown profile: %s\n", name);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--iterations N] [--profile ram|spi_nor|nand|sd]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  static const enum lfsring_mode modes[] = {
+    LFSRING_MODE_STREAM, LFSRING_MODE_OBJECT, LFSRING_MODE_FIXED
+  };
+  static const enum lfsring_write_mode write_modes[] = {
+    LFSRING_NO_OVERWRITE, LFSRING_OVERWRITE
+  };
+  static const lfs_size_t object_sizes[] = { 16, 128, 1024 };
+  static const lfs_size_t file_sizes[] = { 4 * 1024, 64 * 1024 };
+  struct {
+    lfs_size_t read_size;
+    lfs_size_t prog_size;
+    lfs_size_t block_size;
+    lfs_size_t cache_size;
+  } geometries[3];
+  size_t n_geometries = 0;
+  if (profile == NULL) {
+    // Sweep program and cache sizes on top of the in-memory block device.
+    static const lfs_size_t ram_geometries[][2] = { { 16, 64 }, { 16, 512 }, { 256, 512 } };
+    for (size_t g = 0; g < sizeof(ram_geometries) / sizeof(ram_geometries[0]); g++) {
+      geometries[n_geometries].read_size = LFS_READ_SIZE;
+      geometries[n_geometries].prog_size = ram_geometries[g][0];
+      geometries[n_geometries].block_size = LFS_BLOCK_SIZE;
+      geometries[n_geometries].cache_size = ram_geometries[g][1];
+      n_geometries++;
+    }
+  } else {
+    // The geometry is determined by the profile, so only sweep cache sizes.
+    for (lfs_size_t cache_size = profile->page_size;
+         cache_size <= profile->block_size && cache_size <= 4 * profile->page_size;
+         cache_size *= 4) {
+      geometries[n_geometries].read_size = profile->read_size;
+      geometries[n_geometries].prog_size = profile->prog_size;
+      geometries[n_geometries].block_size = profile->block_size;
+      geometries[n_geometries].cache_size = cache_size;
+      n_geometries++;
+    }
+  }
+
+  if (json) {
+    printf("[");
+  } else {
+    printf("profile,mode,write_mode,object_size,file_size,prog_size,cache_size,op,ops,"
+           "ops_per_sec,bytes_per_sec,p50_ns,p99_ns,reads_per_op,progs_per_op,"
+           "erases_per_op,syncs_per_op,read_bytes_per_op,prog_bytes_per_op,erases_per_kib\n");
+  }
+
+  bool first = true;
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    for (size_t w = 0; w < sizeof(write_modes) / sizeof(write_modes[0]); w++) {
+      for (size_t o = 0; o < sizeof(object_sizes) / sizeof(object_sizes[0]); o++) {
+        for (size_t f = 0; f < sizeof(file_sizes) / sizeof(file_sizes[0]); f++) {
+          for (size_t g = 0; g < n_geometries; g++) {
+            struct bench_params p = {
+              .profile = profile,
+              .mode = modes[m],
+              .write_mode = write_modes[w],
+              .object_size = object_sizes[o],
+              .file_size = file_sizes[f],
+              .read_size = geometries[g].read_size,
+              .prog_size = geometries[g].prog_size,
+              .block_size = geometries[g].block_size,
+              .cache_size = geometries[g].cache_size
+            };
+
+            struct bench_samples samples[BENCH_N_OPS] = {
+              [BENCH_APPEND] = { .op = "append" },
+              [BENCH_PEEK] = { .op = "peek" },
+              [BENCH_TAKE] = { .op = "take" },
+              [BENCH_DROP] = { .op = "drop" }
+            };
+
+            run_bench(&p, iterations, samples);
+
+            for (int op = 0; op < BENCH_N_OPS; op++) {
+              report(&p, &samples[op], json, &first);
+              free(samples[op].latencies);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (json) {
+    printf("\n]\n");
+  }
+
+  return 0;
+}
@@ -26,6 +26,12 @@ extern "C"
  */
 #define LFSRING_DEFAULT_ATTR ((uint8_t) 0xCB)
 
+/**
+ * The version of the metadata format. Ring buffers with a different format
+ * version cannot be opened.
+ */
+#define LFSRING_FORMAT_VERSION 1
+
 /**
  * Mode of operation for a ring buffer.
  */
@@ -47,7 +53,17 @@ enum lfsring_mode {
    * or written. When existing data has to be overwritten, the implementation
    * overwrites objects as a whole.
    */
-  LFSRING_MODE_OBJECT
+  LFSRING_MODE_OBJECT,
+  /**
+   * In "fixed" mode, a ring buffer is a sequence of records, which all have the
+   * same size (record_size).
+   *
+   * This mode behaves like LFSRING_MODE_OBJECT, except that records do not need
+   * to be preceded by their size within the file. Thus, no space is wasted,
+   * and skipping records does not require reading from the file. Unless stated
+   * otherwise, references to objects also apply to records.
+   */
+  LFSRING_MODE_FIXED
 };
 
 /**
@@ -64,41 +80,403 @@ enum lfsring_write_mode {
   LFSRING_OVERWRITE
 };
 
+/**
+ * Determines when changes are committed to the file system.
+ *
+ * Until changes have been committed, they are lost upon power loss. Committing
+ * changes less frequently reduces the number of littlefs metadata updates,
+ * which can significantly improve performance.
+ */
+enum lfsring_sync_policy {
+  /**
+   * Commit changes after each operation that modifies the ring buffer.
+   */
+  LFSRING_SYNC_ALWAYS,
+  /**
+   * Commit changes once the read and write positions have moved by at least
+   * sync_threshold bytes in total since the last commit.
+   */
+  LFSRING_SYNC_BYTES,
+  /**
+   * Commit changes once at least sync_threshold operations have modified the
+   * ring buffer since the last commit.
+   */
+  LFSRING_SYNC_OPS,
+  /**
+   * Only commit changes when lfsring_flush or lfsring_close is called.
+   */
+  LFSRING_SYNC_MANUAL
+};
+
+#if defined(LFSRING_YES_HISTOGRAMS) || defined(LFSRING_YES_EVENTS)
+/**
+ * Returns the current time in arbitrary units ("ticks"), e.g., microseconds.
+ * The clock may wrap around.
+ */
+typedef uint32_t (*lfsring_clock_cb)(void* ctx);
+#endif
+
+#ifdef LFSRING_YES_EVENTS
+enum lfsring_event_type {
+  LFSRING_EVENT_BEGIN,
+  LFSRING_EVENT_END
+};
+
+/**
+ * A structured trace event. Each public function call and each internal phase
+ * (writing data, reading data, moving the read and write positions, making
+ * room for new data, and syncing the file) produces a begin event and a
+ * matching end event. Events of the same ring buffer are properly nested.
+ */
+typedef struct {
+  enum lfsring_event_type type;
+  /**
+   * The name of the function or phase. This is a string literal that remains
+   * valid after the callback returns.
+   */
+  const char* name;
+  /**
+   * The ring buffer that produced the event.
+   */
+  const void* ring;
+  /**
+   * The time at which the event occurred, or zero if no clock was configured.
+   */
+  uint32_t time;
+  /**
+   * For begin events, the size argument of the call or phase (usually in
+   * bytes), or zero if there is none. For end events, the result, which is
+   * negative if an error occurred.
+   */
+  lfs_ssize_t value;
+} lfsring_event_t;
+
+/**
+ * Receives trace events. The callback must not call any functions of the ring
+ * buffer that produced the event.
+ */
+typedef void (*lfsring_event_cb)(void* ctx, const lfsring_event_t* event);
+#endif
+
+#ifdef LFSRING_YES_HISTOGRAMS
+/**
+ * The number of buckets of each latency histogram.
+ */
+#ifndef LFSRING_HISTOGRAM_BUCKETS
+#define LFSRING_HISTOGRAM_BUCKETS 16
+#endif
+
+/**
+ * Operations whose latencies are measured.
+ */
+enum lfsring_op {
+  LFSRING_OP_OPEN,
+  /**
+   * Calls to lfsring_append that did not need to overwrite existing data.
+   */
+  LFSRING_OP_APPEND,
+  /**
+   * Calls to lfsring_append that overwrote existing data.
+   */
+  LFSRING_OP_APPEND_OVERWRITE,
+  LFSRING_OP_PEEK,
+  LFSRING_OP_TAKE,
+  LFSRING_OP_DROP,
+  LFSRING_N_OPS
+};
+
+/**
+ * A histogram of latencies with logarithmic buckets. The first bucket counts
+ * calls that took zero ticks, and bucket i > 0 counts calls that took at least
+ * 2^(i-1) and less than 2^i ticks, except for the last bucket, which also
+ * counts all longer calls.
+ */
+typedef struct {
+  uint32_t count[LFSRING_HISTOGRAM_BUCKETS];
+  /**
+   * The longest duration in ticks.
+   */
+  uint32_t max;
+} lfsring_histogram_t;
+
+typedef struct {
+  lfsring_histogram_t ops[LFSRING_N_OPS];
+} lfsring_histograms_t;
+#endif
+
 typedef struct {
   void* file_buffer;
+  /**
+   * An optional second file buffer. If not NULL, the file is opened a second
+   * time for reading, such that reading old data and appending new data do not
+   * evict each other's cached blocks. The path that is passed to lfsring_open
+   * must then remain valid until the ring buffer is closed.
+   */
+  void* read_buffer;
   uint8_t attr_metadata;
+  /**
+   * The size of the file. The file size, the mode, and the record size are
+   * stored in the metadata and must not change once a ring buffer has been
+   * created. If the file size is zero, an existing ring buffer is opened with
+   * its stored file size, mode, and record size.
+   */
   lfs_size_t file_size;
   enum lfsring_mode mode;
+  /**
+   * The size of each record in LFSRING_MODE_FIXED.
+   */
+  lfs_size_t record_size;
+  /**
+   * If true, the file only grows towards the file size as data is appended,
+   * and is truncated whenever the ring buffer becomes empty, such that littlefs
+   * can use the blocks for other files in the meantime. Growing the file may
+   * require moving data within the file.
+   */
+  bool elastic;
+  /**
+   * If true, objects never wrap around the end of the file, such that each
+   * object can be read with a single contiguous access. An object that does
+   * not fit before the end of the file is preceded by padding and begins at
+   * the start of the file instead. Only supported in LFSRING_MODE_OBJECT and
+   * not for elastic ring buffers.
+   */
+  bool wrap_free;
+  /**
+   * If true, each object is preceded by a variable-length header of one byte
+   * for objects of up to 126 bytes and two bytes for objects of up to 16382
+   * bytes, instead of a four-byte header. Only supported in
+   * LFSRING_MODE_OBJECT.
+   */
+  bool varint_headers;
+  /**
+   * If true, a CRC-32C checksum of each object is stored after its size and
+   * verified whenever the object is read, such that reading corrupted data
+   * fails with LFS_ERR_CORRUPT. Only supported in LFSRING_MODE_OBJECT. If
+   * LFSRING_YES_CRC_SLICE_BY_8 is defined, a faster implementation is used
+   * that requires 8 KiB of constant tables, unless the compiler targets CPUs
+   * with CRC instructions (SSE 4.2 or ARMv8), which are used instead.
+   */
+  bool checksums;
+  /**
+   * If true, checksums are not verified when reading objects, e.g., when the
+   * data is trusted. Unlike checksums, this is not stored in the metadata.
+   */
+  bool no_verify;
+  /**
+   * If true, the file is opened with LFS_O_RDONLY, and operations that would
+   * modify the ring buffer fail with LFS_ERR_INVAL. Together with a file size
+   * of zero, this allows tools to inspect existing ring buffers.
+   */
+  bool read_only;
+  enum lfsring_sync_policy sync_policy;
+  lfs_size_t sync_threshold;
+  /**
+   * An optional buffer for an in-memory index of object positions, which is
+   * only used in LFSRING_MODE_OBJECT. The index speeds up dropping objects,
+   * overwriting objects, and seeking cursors, which otherwise need to read the
+   * header of each object that is being skipped.
+   */
+  lfs_off_t* index_buffer;
+  /**
+   * The number of entries in the index buffer, which must be at least 2 for
+   * the index to be used.
+   */
+  lfs_size_t index_size;
+  /**
+   * The index initially remembers the position of every index_interval-th
+   * object, rounded up to a power of two. Whenever the index buffer is full,
+   * the interval is doubled.
+   */
+  lfs_size_t index_interval;
+#if defined(LFSRING_YES_HISTOGRAMS) || defined(LFSRING_YES_EVENTS)
+  /**
+   * The clock that is used to measure latencies and to timestamp events. If
+   * NULL, latencies are not measured and all timestamps are zero.
+   */
+  lfsring_clock_cb clock;
+  void* clock_ctx;
+#endif
+#ifdef LFSRING_YES_EVENTS
+  /**
+   * An optional callback that receives trace events.
+   */
+  lfsring_event_cb event_cb;
+  void* event_ctx;
+#endif
 } lfsring_config_t;
 
+#ifdef LFSRING_YES_STATS
+/**
+ * Classes of errors that are counted separately.
+ */
+enum lfsring_error_class {
+  LFSRING_ERROR_IO,
+  LFSRING_ERROR_CORRUPT,
+  LFSRING_ERROR_NOENT,
+  LFSRING_ERROR_INVAL,
+  LFSRING_ERROR_NOSPC,
+  LFSRING_ERROR_NOMEM,
+  LFSRING_ERROR_OTHER,
+  LFSRING_N_ERROR_CLASSES
+};
+
+/**
+ * Cumulative counters, which are only available if LFSRING_YES_STATS is
+ * defined.
+ */
+typedef struct {
+  /**
+   * The number of bytes that have been appended, excluding object headers.
+   */
+  uint64_t bytes_appended;
+  /**
+   * The number of bytes that have been read, excluding object headers.
+   */
+  uint64_t bytes_read;
+  /**
+   * The number of bytes by which the read position has been moved by take,
+   * drop, and similar operations.
+   */
+  uint64_t bytes_consumed;
+  /**
+   * The number of bytes by which the read position has been moved by
+   * LFSRING_OVERWRITE.
+   */
+  uint64_t bytes_overwritten;
+  /**
+   * The number of bytes at the end of the file that have been skipped because
+   * the next object did not fit (see wrap_free).
+   */
+  uint64_t bytes_padded;
+  uint32_t objects_appended;
+  uint32_t objects_consumed;
+  uint32_t objects_overwritten;
+  /**
+   * The number of object headers that have been read from the file, e.g., in
+   * order to determine how many objects need to be dropped or overwritten.
+   */
+  uint32_t header_reads;
+  uint32_t syncs;
+  uint32_t seeks;
+  uint32_t rewinds;
+  /**
+   * The number of errors that public functions have returned, by class.
+   */
+  uint32_t errors[LFSRING_N_ERROR_CLASSES];
+} lfsring_stats_t;
+#endif
+
+struct lfsring;
+
+/**
+ * A group of ring buffers that share a budget of bytes. See lfsring_group_add.
+ */
+typedef struct lfsring_group {
+  lfs_size_t budget;
+  struct lfsring* rings;
+} lfsring_group_t;
+
 /**
  * A ring buffer backed by a littlefs file.
  *
  * Note that, even if the underlying block device is thread-safe, the high-level
  * ring buffer operations are not.
  */
-typedef struct {
+typedef struct lfsring {
   lfs_t* backend;
   union {
-    uint8_t bytes[12];
+    uint8_t bytes[36];
     struct {
       lfs_off_t read_low;
       lfs_off_t read_high;
       lfs_off_t write_dist;
+      lfs_size_t count;
+      uint8_t version;
+      uint8_t mode;
+      uint8_t flags;
+      uint8_t reserved;
+      lfs_size_t file_size;
+      lfs_size_t record_size;
+      lfs_size_t capacity;
+      lfs_off_t base;
     } le;
   } attr_buf;
   struct lfs_attr attr;
   struct lfs_file_config file_config;
   lfs_file_t file;
+  /**
+   * The optional reader handle only sees data that had been committed when it
+   * was opened, that is, data before the absolute position read_file_end. It
+   * is closed whenever the writer handle commits changes to the file.
+   */
+  const char* path;
+  struct lfs_file_config read_file_config;
+  lfs_file_t read_file;
+  bool read_file_open;
+  uint64_t read_file_end;
+  bool unsynced_writes;
   lfs_size_t file_size;
+  /**
+   * The size of the part of the file that is in use, which is less than the
+   * file size only for elastic ring buffers.
+   */
+  lfs_size_t capacity;
+  bool elastic;
+  bool wrap_free;
+  bool varint_headers;
+  bool checksums;
+  bool verify;
+  bool read_only;
   enum lfsring_mode mode;
+  lfs_size_t record_size;
+  enum lfsring_sync_policy sync_policy;
+  lfs_size_t sync_threshold;
+  lfs_size_t unsynced_bytes;
+  lfs_size_t unsynced_ops;
+  lfs_size_t head_seq;
+  lfs_off_t* index;
+  lfs_size_t index_size;
+  lfs_size_t index_interval;
+  lfs_size_t index_start;
+  lfs_size_t index_len;
+  lfs_size_t index_seq;
+  lfs_size_t obj_count;
+  bool index_valid;
+  lfsring_group_t* group;
+  struct lfsring* group_next;
+  lfs_size_t group_min;
+  uint32_t group_weight;
+#ifdef LFSRING_YES_STATS
+  lfsring_stats_t stats;
+#endif
+#if defined(LFSRING_YES_HISTOGRAMS) || defined(LFSRING_YES_EVENTS)
+  lfsring_clock_cb clock;
+  void* clock_ctx;
+#endif
+#ifdef LFSRING_YES_HISTOGRAMS
+  lfsring_histograms_t histograms;
+#endif
+#ifdef LFSRING_YES_EVENTS
+  lfsring_event_cb event_cb;
+  void* event_ctx;
+#endif
 } lfsring_t;
 
 /**
  * Opens a ring buffer backed by a littlefs file.
  *
+ * If the file already contains a ring buffer, its stored file size, mode, and
+ * record size must match the configuration, unless the configured file size is
+ * zero. Ring buffers created by older versions of this library are upgraded
+ * when their metadata is committed for the next time.
+ *
  * Note that, even if the underlying block device is thread-safe, the high-level
  * ring buffer operations are not.
+ *
+ * @return 0 on success, LFS_ERR_INVAL if the ring buffer is incompatible with
+ *         the configuration or its metadata format is not supported,
+ *         LFS_ERR_CORRUPT if the metadata is invalid, or another negative error
+ *         code
  */
 int lfsring_open(lfsring_t* ring, lfs_t* lfs, const char* path,
                  const lfsring_config_t* config);
@@ -114,6 +492,43 @@ int lfsring_open(lfsring_t* ring, lfs_t* lfs, const char* path,
  */
 bool lfsring_is_empty(lfsring_t* ring);
 
+/**
+ * Returns the number of objects in a ring buffer.
+ *
+ * The number of objects is stored together with the read and write positions,
+ * so this function does not access the file system.
+ *
+ * @param ring the ring buffer
+ * @return the number of objects, or LFS_ERR_INVAL in LFSRING_MODE_STREAM
+ */
+lfs_ssize_t lfsring_count(lfsring_t* ring);
+
+/**
+ * Returns the number of bytes that are currently in use, including object
+ * headers.
+ *
+ * This function does not access the file system.
+ *
+ * @param ring the ring buffer
+ * @return the number of bytes between the read position and the write position
+ */
+lfs_size_t lfsring_used_bytes(lfsring_t* ring);
+
+/**
+ * Returns the number of bytes that can be written without overwriting existing
+ * data, including object headers.
+ *
+ * If the ring buffer belongs to a group, the result is limited by the remaining
+ * budget of the group. Padding that wrap_free placement might insert before the
+ * next object is not taken into account.
+ *
+ * This function does not access the file system.
+ *
+ * @param ring the ring buffer
+ * @return the number of bytes between the write position and the read position
+ */
+lfs_size_t lfsring_free_bytes(lfsring_t* ring);
+
 /**
  * Appends data to a ring buffer.
  *
@@ -130,6 +545,8 @@ bool lfsring_is_empty(lfsring_t* ring);
  * which means that the buffer used to read objects must be large enough to hold
  * any object that is being written to the file.
  *
+ * In LFSRING_MODE_FIXED, data_size must be equal to the record size.
+ *
  * @param ring the ring buffer
  * @param data the data to write
  * @param data_size the number of bytes of data
@@ -138,20 +555,56 @@ bool lfsring_is_empty(lfsring_t* ring);
 int lfsring_append(lfsring_t* ring, const void* data, lfs_size_t data_size,
                    enum lfsring_write_mode write_mode);
 
+/**
+ * An object that is passed to lfsring_append_batch.
+ */
+typedef struct {
+  const void* data;
+  lfs_size_t size;
+} lfsring_object_t;
+
+/**
+ * Appends multiple objects to a ring buffer.
+ *
+ * This is not supported in LFSRING_MODE_STREAM. All objects are written using
+ * a single update of the ring buffer metadata, which is considerably faster
+ * than calling lfsring_append for each object.
+ *
+ * If the write mode is LFSRING_NO_OVERWRITE, objects are appended in order
+ * until the next object does not fit into the available space. If not even the
+ * first object fits, LFS_ERR_NOSPC is returned.
+ *
+ * If the write mode is LFSRING_OVERWRITE, existing data will be discarded as
+ * necessary, and all objects are accepted. If the objects do not fit into the
+ * ring buffer at the same time, leading objects of the batch are discarded,
+ * just as if they had been appended one by one, and so is all data that was
+ * stored in the ring buffer before. If any single object is too
+ * large to be stored in the ring buffer, LFS_ERR_NOSPC is returned and the
+ * buffer remains unmodified.
+ *
+ * @param ring the ring buffer
+ * @param objects the objects to append
+ * @param n_objects the number of objects
+ * @param write_mode whether to overwrite existing data
+ * @return number of objects that have been accepted, or a negative error code
+ */
+lfs_ssize_t lfsring_append_batch(lfsring_t* ring, const lfsring_object_t* objects,
+                                 lfs_size_t n_objects, enum lfsring_write_mode write_mode);
+
 /**
  * Reads data from a ring buffer without removing it.
  *
- * If the ring buffer was created as LFSRING_MODE_OBJECT, the supplied buffer
- * must be large enough to receive the next object. Otherwise, the buffer may
- * have any size.
+ * If the ring buffer was created as LFSRING_MODE_OBJECT or LFSRING_MODE_FIXED,
+ * the supplied buffer must be large enough to receive the next object.
+ * Otherwise, the buffer may have any size.
  *
  * In LFSRING_MODE_STREAM, upon success, exactly buffer_size bytes are
  * retrieved, unless fewer bytes are available. If no data is available, the
  * function will return 0.
  *
- * In LFSRING_MODE_OBJECT, upon success, only one object is retrieved, and the
- * size of the object is returned. Objects may have a size of zero. If no object
- * is available in the buffer, LFS_ERR_NOENT is returned.
+ * In LFSRING_MODE_OBJECT and LFSRING_MODE_FIXED, upon success, only one object
+ * is retrieved, and the size of the object is returned. Objects may have a size
+ * of zero. If no object is available in the buffer, LFS_ERR_NOENT is returned.
  *
  * @param ring the ring buffer
  * @param buffer where to write data to
@@ -163,17 +616,17 @@ lfs_ssize_t lfsring_peek(lfsring_t* ring, void* buffer, lfs_size_t buffer_size);
 /**
  * Reads data from a ring buffer and removes it.
  *
- * If the ring buffer was created as LFSRING_MODE_OBJECT, the supplied buffer
- * must be large enough to receive the next object. Otherwise, the buffer may
- * have any size.
+ * If the ring buffer was created as LFSRING_MODE_OBJECT or LFSRING_MODE_FIXED,
+ * the supplied buffer must be large enough to receive the next object.
+ * Otherwise, the buffer may have any size.
  *
  * In LFSRING_MODE_STREAM, upon success, exactly buffer_size bytes are
  * retrieved, unless fewer bytes are available. If no data is available, the
  * function will return 0.
  *
- * In LFSRING_MODE_OBJECT, upon success, only one object is retrieved, and the
- * size of the object is returned. Objects may have a size of zero. If no object
- * is available in the buffer, LFS_ERR_NOENT is returned.
+ * In LFSRING_MODE_OBJECT and LFSRING_MODE_FIXED, upon success, only one object
+ * is retrieved, and the size of the object is returned. Objects may have a size
+ * of zero. If no object is available in the buffer, LFS_ERR_NOENT is returned.
  *
  * @param ring the ring buffer
  * @param buffer where to write data to
@@ -182,22 +635,473 @@ lfs_ssize_t lfsring_peek(lfsring_t* ring, void* buffer, lfs_size_t buffer_size);
  */
 lfs_ssize_t lfsring_take(lfsring_t* ring, void* buffer, lfs_size_t buffer_size);
 
+/**
+ * Reads as many objects as possible from a ring buffer and removes them.
+ *
+ * This is not supported in LFSRING_MODE_STREAM. Objects are retrieved in
+ * order and stored contiguously within the buffer, until either max_objects
+ * objects have been retrieved, the next object does not fit into the remaining
+ * space of the buffer, or no objects are left. The size of each retrieved
+ * object is stored in sizes. All objects are removed using a single update of
+ * the ring buffer metadata.
+ *
+ * If no object is available in the buffer, LFS_ERR_NOENT is returned. If the
+ * buffer is too small to receive the next object, LFS_ERR_NOMEM is returned.
+ *
+ * @param ring the ring buffer
+ * @param buffer where to write objects to
+ * @param buffer_size the size of the buffer
+ * @param sizes where to write the sizes of the objects to
+ * @param max_objects the maximum number of objects to retrieve
+ * @return number of objects that have been retrieved, or a negative error code
+ */
+lfs_ssize_t lfsring_take_many(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                              lfs_size_t* sizes, lfs_size_t max_objects);
+
+/**
+ * A contiguous part of the data within a ring buffer that is passed to the
+ * callback of lfsring_visit.
+ */
+typedef struct {
+  /**
+   * The data of this chunk, which is only valid during the callback.
+   */
+  const void* data;
+  /**
+   * The number of bytes in this chunk.
+   */
+  lfs_size_t size;
+  /**
+   * The offset of this chunk within the current object or, in
+   * LFSRING_MODE_STREAM, within all visited data.
+   */
+  lfs_off_t offset;
+  /**
+   * The size of the current object or, in LFSRING_MODE_STREAM, the number of
+   * bytes that are being visited.
+   */
+  lfs_size_t total_size;
+} lfsring_chunk_t;
+
+/**
+ * A callback that receives data from lfsring_visit.
+ *
+ * The callback should return 0 to receive the next chunk, a positive value to
+ * stop visiting data, or a negative error code, which is then returned by
+ * lfsring_visit.
+ */
+typedef int (*lfsring_visit_cb)(void* ctx, const lfsring_chunk_t* chunk);
+
+/**
+ * Passes data from a ring buffer to a callback without removing it.
+ *
+ * Unlike lfsring_peek, this function does not require a buffer that is large
+ * enough to hold an entire object. Instead, data is read into the given buffer
+ * in chunks, and each chunk is passed to the callback. Chunks are aligned to
+ * multiples of buffer_size within the file, so a buffer whose size is equal to
+ * the littlefs cache size is a good choice.
+ *
+ * In LFSRING_MODE_STREAM, up to max_bytes bytes are visited.
+ *
+ * In LFSRING_MODE_OBJECT and LFSRING_MODE_FIXED, objects are visited in order
+ * as long as the total size of all visited objects does not exceed max_bytes.
+ * Each object is passed to the callback as one or more chunks, and the first
+ * chunk of each object has an offset of 0. Empty objects are passed as a single
+ * empty chunk.
+ *
+ * If the callback returns a positive value, no further chunks are visited. An
+ * object only counts as visited if all of its chunks have been passed to the
+ * callback. Checksums are not verified because chunks are passed to the
+ * callback before the entire object has been read.
+ *
+ * @param ring the ring buffer
+ * @param buffer where to temporarily store chunks
+ * @param buffer_size the maximum size of a chunk
+ * @param max_bytes the maximum number of bytes to visit
+ * @param cb the callback
+ * @param ctx an arbitrary pointer that is passed to the callback
+ * @return in LFSRING_MODE_STREAM, the number of bytes that have been visited,
+ *         and otherwise, the number of objects that have been visited, which
+ *         can be passed to lfsring_drop, or a negative error code
+ */
+lfs_ssize_t lfsring_visit(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                          lfs_size_t max_bytes, lfsring_visit_cb cb, void* ctx);
+
+/**
+ * Verifies the checksums of all objects in a ring buffer that was created with
+ * checksums enabled, regardless of no_verify.
+ *
+ * @param ring the ring buffer
+ * @param buffer where to temporarily store object data
+ * @param buffer_size the size of the buffer, which does not need to be large
+ *        enough to hold an entire object
+ * @return the number of objects that have been verified, LFS_ERR_CORRUPT if
+ *         any object does not match its checksum, LFS_ERR_INVAL if the ring
+ *         buffer does not store checksums, or another negative error code
+ */
+lfs_ssize_t lfsring_verify(lfsring_t* ring, void* buffer, lfs_size_t buffer_size);
+
 /**
  * Moves the read position forward, effectively discarding data.
  *
  * In LFSRING_MODE_STREAM, the distance is the number of bytes.
  *
- * In LFSRING_MODE_OBJECT, the distance is the number of objects.
+ * In LFSRING_MODE_OBJECT and LFSRING_MODE_FIXED, the distance is the number of
+ * objects. In LFSRING_MODE_FIXED, this does not require reading from the file.
  */
 int lfsring_drop(lfsring_t* ring, lfs_off_t n);
 
+/**
+ * The size of the buffer on the stack that lfsring_resize uses to move data
+ * within the file.
+ */
+#ifndef LFSRING_MOVE_BUFFER_SIZE
+#define LFSRING_MOVE_BUFFER_SIZE 64
+#endif
+
+/**
+ * Changes the size of the file that backs a ring buffer, retaining its
+ * contents.
+ *
+ * If the ring buffer contains more data than fits into the new size, the oldest
+ * data is discarded, as if it was overwritten. Wrapped data is moved within the
+ * file as necessary, using a buffer of LFSRING_MOVE_BUFFER_SIZE bytes. All
+ * changes, including any that have not been committed yet, are committed to
+ * the file system atomically, regardless of the sync policy.
+ *
+ * Cursors become invalid when the ring buffer is resized. If an error occurs,
+ * the ring buffer should be closed.
+ *
+ * @param ring the ring buffer
+ * @param new_size the new size of the file, which must not be zero and, in
+ *                 LFSRING_MODE_FIXED, must be at least the record size
+ */
+int lfsring_resize(lfsring_t* ring, lfs_size_t new_size);
+
+/**
+ * Commits all changes to the file system, regardless of the sync policy.
+ *
+ * @param ring the ring buffer
+ */
+int lfsring_flush(lfsring_t* ring);
+
+/**
+ * A position within a ring buffer in LFSRING_MODE_OBJECT or LFSRING_MODE_FIXED.
+ *
+ * A cursor allows iterating over objects without removing them. It remains
+ * valid as long as the object it points to has not been removed from the ring
+ * buffer. Appending objects does not invalidate cursors.
+ */
+typedef struct {
+  uint64_t pos;
+  lfs_size_t seq;
+  lfs_size_t obj_size;
+  bool has_obj_size;
+} lfsring_cursor_t;
+
+/**
+ * Initializes a cursor that points to the first object in a ring buffer.
+ *
+ * This is not supported in LFSRING_MODE_STREAM.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor to initialize
+ */
+int lfsring_cursor_init(lfsring_t* ring, lfsring_cursor_t* cursor);
+
+/**
+ * Moves a cursor to the n-th object in a ring buffer.
+ *
+ * If n is equal to the number of objects, the cursor is moved to the end of the
+ * ring buffer. If there are fewer objects, LFS_ERR_INVAL is returned.
+ *
+ * If the ring buffer has an index, this only needs to read a few object headers
+ * regardless of n.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor
+ * @param n the number of objects before the object the cursor should point to
+ */
+int lfsring_cursor_seek(lfsring_t* ring, lfsring_cursor_t* cursor, lfs_size_t n);
+
+/**
+ * Returns the size of the object that a cursor points to.
+ *
+ * If the cursor has reached the end of the ring buffer, LFS_ERR_NOENT is
+ * returned. If the object that the cursor points to has been removed,
+ * LFS_ERR_INVAL is returned.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor
+ * @return the size of the object, or a negative error code
+ */
+lfs_ssize_t lfsring_cursor_size(lfsring_t* ring, lfsring_cursor_t* cursor);
+
+/**
+ * Reads the object that a cursor points to without moving the cursor.
+ *
+ * This behaves like lfsring_peek, except that the object is the one that the
+ * cursor points to.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor
+ * @param buffer where to write data to
+ * @param buffer_size the maximum number of bytes to retrieve
+ * @return the size of the object, or a negative error code
+ */
+lfs_ssize_t lfsring_cursor_peek(lfsring_t* ring, lfsring_cursor_t* cursor,
+                                void* buffer, lfs_size_t buffer_size);
+
+/**
+ * Moves a cursor to the next object.
+ *
+ * If the cursor has reached the end of the ring buffer, LFS_ERR_NOENT is
+ * returned.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor
+ */
+int lfsring_cursor_next(lfsring_t* ring, lfsring_cursor_t* cursor);
+
+/**
+ * Removes all objects before the object that a cursor points to.
+ *
+ * The objects are removed using a single update of the ring buffer metadata.
+ * The cursor remains valid.
+ *
+ * @param ring the ring buffer
+ * @param cursor the cursor
+ */
+int lfsring_cursor_drop(lfsring_t* ring, lfsring_cursor_t* cursor);
+
 /**
  * Closes a ring buffer.
  *
+ * This commits all changes to the file system, regardless of the sync policy.
+ *
  * @param ring the ring buffer
  */
 int lfsring_close(lfsring_t* ring);
 
+/**
+ * Initializes a group of ring buffers that share a budget of bytes.
+ *
+ * @param group the group
+ * @param budget the maximum number of bytes, including object headers, that
+ *               all ring buffers in the group may use together
+ */
+void lfsring_group_init(lfsring_group_t* group, lfs_size_t budget);
+
+/**
+ * Adds an open ring buffer to a group. A ring buffer can only belong to a
+ * single group at a time, and it is removed from the group when it is closed.
+ *
+ * Appending to a ring buffer in the group fails with LFS_ERR_NOSPC if it would
+ * exceed the budget, unless the write mode is LFSRING_OVERWRITE. In that case,
+ * the oldest data of ring buffers with a lower weight is discarded, starting
+ * with the lowest weight, and then the oldest data of the ring buffer itself.
+ * Ring buffers with the same or a higher weight are never affected, and other
+ * ring buffers never drop below their minimum size. The file size of each ring
+ * buffer remains a limit for that ring buffer.
+ *
+ * @param group the group
+ * @param ring the ring buffer
+ * @param min_size the number of bytes that other ring buffers cannot evict
+ * @param weight the priority of the ring buffer's data
+ */
+void lfsring_group_add(lfsring_group_t* group, lfsring_t* ring, lfs_size_t min_size,
+                       uint32_t weight);
+
+/**
+ * Removes a ring buffer from its group, if any.
+ *
+ * @param ring the ring buffer
+ */
+void lfsring_group_remove(lfsring_t* ring);
+
+/**
+ * Returns the number of bytes that all ring buffers in a group use together.
+ *
+ * @param group the group
+ * @return the sum of the used bytes of all ring buffers in the group
+ */
+lfs_size_t lfsring_group_used_bytes(lfsring_group_t* group);
+
+#ifdef LFSRING_YES_HISTOGRAMS
+/**
+ * Retrieves the latency histograms of a ring buffer, which are reset when the
+ * ring buffer is opened. Only available if LFSRING_YES_HISTOGRAMS is defined.
+ *
+ * @param ring the ring buffer
+ * @param histograms the histograms
+ */
+void lfsring_get_histograms(lfsring_t* ring, lfsring_histograms_t* histograms);
+
+/**
+ * Resets the latency histograms of a ring buffer.
+ *
+ * @param ring the ring buffer
+ */
+void lfsring_reset_histograms(lfsring_t* ring);
+#endif
+
+#ifdef LFSRING_YES_STATS
+/**
+ * Retrieves the counters of a ring buffer, which are reset when the ring buffer
+ * is opened.
+ *
+ * @param ring the ring buffer
+ * @param stats the counters
+ */
+void lfsring_get_stats(lfsring_t* ring, lfsring_stats_t* stats);
+
+/**
+ * Resets the counters of a ring buffer.
+ *
+ * @param ring the ring buffer
+ */
+void lfsring_reset_stats(lfsring_t* ring);
+#endif
+
+/**
+ * The maximum length of the directory path of a segmented ring buffer,
+ * including the terminating null character and the name of a segment file.
+ */
+#ifndef LFSRING_SEG_PATH_MAX
+#define LFSRING_SEG_PATH_MAX 64
+#endif
+
+typedef struct {
+  /**
+   * An optional buffer for the segment that is currently being written to.
+   */
+  void* file_buffer;
+  /**
+   * An optional buffer for the segment that is currently being read from, if it
+   * is not the segment that is being written to.
+   */
+  void* read_buffer;
+  uint8_t attr_metadata;
+  /**
+   * The maximum size of each segment file.
+   */
+  lfs_size_t segment_size;
+  /**
+   * The maximum number of segment files.
+   */
+  lfs_size_t segment_count;
+  /**
+   * Either LFSRING_MODE_OBJECT or LFSRING_MODE_FIXED.
+   */
+  enum lfsring_mode mode;
+  lfs_size_t record_size;
+} lfsring_seg_config_t;
+
+/**
+ * A ring buffer backed by multiple littlefs files ("segments") within a
+ * directory.
+ *
+ * Unlike lfsring_t, a segmented ring buffer never overwrites data within a
+ * file. Instead, objects are always appended to the most recent segment, and
+ * segments are removed as a whole once they have been consumed or overwritten.
+ * Because littlefs files are copy-on-write, this avoids rewriting the middle of
+ * large files, which considerably reduces write amplification and latency for
+ * large ring buffers.
+ *
+ * Objects never span multiple segments, so the capacity of a segmented ring
+ * buffer is at most segment_count * segment_size bytes, and each object must
+ * fit into a single segment.
+ *
+ * Note that, even if the underlying block device is thread-safe, the high-level
+ * ring buffer operations are not.
+ */
+typedef struct {
+  lfs_t* backend;
+  union {
+    uint8_t bytes[8];
+    struct {
+      lfs_off_t first_seg;
+      lfs_off_t read_off;
+    } le;
+  } attr_buf;
+  struct lfs_attr attr;
+  struct lfs_file_config file_config;
+  struct lfs_file_config read_file_config;
+  lfs_file_t file;
+  lfs_file_t read_file;
+  bool read_file_open;
+  lfs_size_t read_seg;
+  lfs_size_t last_seg;
+  lfs_size_t segment_size;
+  lfs_size_t segment_count;
+  enum lfsring_mode mode;
+  lfs_size_t record_size;
+  lfs_size_t path_len;
+  char path[LFSRING_SEG_PATH_MAX];
+} lfsring_seg_t;
+
+/**
+ * Opens a segmented ring buffer within the given directory, which is created if
+ * it does not exist.
+ *
+ * The directory should not contain any other files.
+ */
+int lfsring_seg_open(lfsring_seg_t* ring, lfs_t* lfs, const char* path,
+                     const lfsring_seg_config_t* config);
+
+/**
+ * Checks if a segmented ring buffer is empty.
+ *
+ * @param ring the ring buffer
+ * @return true if the buffer is empty, false otherwise
+ */
+bool lfsring_seg_is_empty(lfsring_seg_t* ring);
+
+/**
+ * Appends an object to a segmented ring buffer.
+ *
+ * If the current segment does not have enough space left, a new segment is
+ * created. If the maximum number of segments has been reached and the write
+ * mode is LFSRING_OVERWRITE, the oldest segment is removed, including all
+ * objects within it. Otherwise, LFS_ERR_NOSPC is returned.
+ *
+ * @param ring the ring buffer
+ * @param data the object to write
+ * @param data_size the size of the object
+ * @param write_mode whether to overwrite existing data
+ */
+int lfsring_seg_append(lfsring_seg_t* ring, const void* data, lfs_size_t data_size,
+                       enum lfsring_write_mode write_mode);
+
+/**
+ * Reads the next object from a segmented ring buffer without removing it.
+ *
+ * This behaves like lfsring_peek.
+ */
+lfs_ssize_t lfsring_seg_peek(lfsring_seg_t* ring, void* buffer, lfs_size_t buffer_size);
+
+/**
+ * Reads the next object from a segmented ring buffer and removes it.
+ *
+ * This behaves like lfsring_take.
+ */
+lfs_ssize_t lfsring_seg_take(lfsring_seg_t* ring, void* buffer, lfs_size_t buffer_size);
+
+/**
+ * Removes the next n objects from a segmented ring buffer.
+ *
+ * This behaves like lfsring_drop. Segments that have been consumed entirely are
+ * removed.
+ */
+int lfsring_seg_drop(lfsring_seg_t* ring, lfs_size_t n);
+
+/**
+ * Closes a segmented ring buffer.
+ *
+ * @param ring the ring buffer
+ */
+int lfsring_seg_close(lfsring_seg_t* ring);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
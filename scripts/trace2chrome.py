@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Converts ring buffer trace events to the Chrome trace event format.
+
+The input is a log that contains one line per event, produced by an event
+callback (see lfsring_event_cb) that prints
+
+    lfsring <B|E> <ring> <time> <name> <value>
+
+where <ring> is any token that identifies the ring buffer (e.g., the pointer
+printed with %p), <time> is the unsigned 32-bit timestamp, and <value> is the
+signed value of the event. Other lines are ignored, so the events may be
+interleaved with unrelated log output.
+
+The resulting JSON file can be opened with chrome://tracing or
+https://ui.perfetto.dev. Each ring buffer is shown as a separate thread.
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse_events(lines):
+    for line in lines:
+        fields = line.split()
+        if len(fields) != 6 or fields[0] != 'lfsring' or fields[1] not in ('B', 'E'):
+            continue
+        try:
+            yield fields[1], fields[2], int(fields[3]), fields[4], int(fields[5])
+        except ValueError:
+            continue
+
+
+def convert(lines, tick_us):
+    trace_events = []
+    threads = {}
+    for phase, ring, time, name, value in parse_events(lines):
+        thread = threads.get(ring)
+        if thread is None:
+            thread = threads[ring] = {'tid': len(threads) + 1, 'last': time, 'base': 0}
+            trace_events.append({
+                'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': thread['tid'],
+                'args': {'name': 'ring ' + ring}
+            })
+        # The clock is only 32 bits wide and may wrap around.
+        if time < thread['last']:
+            thread['base'] += 1 << 32
+        thread['last'] = time
+
+        key = 'size' if phase == 'B' else 'result'
+        trace_events.append({
+            'name': name, 'ph': phase, 'pid': 1, 'tid': thread['tid'],
+            'ts': (thread['base'] + time) * tick_us,
+            'args': {key: value}
+        })
+    return {'traceEvents': trace_events, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'), default=sys.stdin,
+                        help='log file (default: standard input)')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'), default=sys.stdout,
+                        help='JSON file (default: standard output)')
+    parser.add_argument('--tick-us', type=float, default=1.0,
+                        help='duration of one clock tick in microseconds (default: 1)')
+    args = parser.parse_args()
+
+    json.dump(convert(args.input, args.tick_us), args.output)
+    args.output.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -2,38 +2,75 @@
 
 #include <string.h>
 
-int lfsring_open(lfsring_t* ring, lfs_t* lfs, const char* path,
-                 const lfsring_config_t* config) {
-  LFSRING_TRACE("lfsring_open(%p, %p, \"%s\", %p {  })", (void*) ring, (void*) lfs, path, (void*) config);
-
-  ring->attr.type = config->attr_metadata;
-  ring->attr.buffer = ring->attr_buf.bytes;
-  ring->attr.size = sizeof(ring->attr_buf.bytes);
-
-  LFS_ASSERT(sizeof(ring->attr_buf.bytes) == sizeof(ring->attr_buf));
-
-  // If the attribute does not exist, littlefs will silently create it. Thus,
-  // we need to initialize the buffer.
-  memset(ring->attr_buf.bytes, 0, sizeof(ring->attr_buf.bytes));
-
-  memset(&ring->file_config, 0, sizeof(ring->file_config));
-  ring->file_config.buffer = config->file_buffer;
-  ring->file_config.attrs = &ring->attr;
-  ring->file_config.attr_count = 1;
-
-  int flags = LFS_O_CREAT | LFS_O_RDWR;
-  int lfs_err = lfs_file_opencfg(lfs, &ring->file, path, flags, &ring->file_config);
-  if (lfs_err != 0) {
-    return lfs_err;
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_acle.h>
+#endif
+
+#ifdef LFSRING_YES_STATS
+#define LFSRING_STAT_ADD(ring, counter, n) ((ring)->stats.counter += (n))
+#else
+#define LFSRING_STAT_ADD(ring, counter, n) ((void) 0)
+#endif
+
+// Counts errors that public functions return.
+static inline lfs_ssize_t count_error(lfsring_t* ring, lfs_ssize_t ret) {
+#ifdef LFSRING_YES_STATS
+  if (ret < 0) {
+    enum lfsring_error_class class;
+    switch (ret) {
+    case LFS_ERR_IO:
+      class = LFSRING_ERROR_IO;
+      break;
+    case LFS_ERR_CORRUPT:
+      class = LFSRING_ERROR_CORRUPT;
+      break;
+    case LFS_ERR_NOENT:
+      class = LFSRING_ERROR_NOENT;
+      break;
+    case LFS_ERR_INVAL:
+      class = LFSRING_ERROR_INVAL;
+      break;
+    case LFS_ERR_NOSPC:
+      class = LFSRING_ERROR_NOSPC;
+      break;
+    case LFS_ERR_NOMEM:
+      class = LFSRING_ERROR_NOMEM;
+      break;
+    default:
+      class = LFSRING_ERROR_OTHER;
+      break;
+    }
+    ring->stats.errors[class]++;
   }
+#else
+  (void) ring;
+#endif
+  return ret;
+}
 
-  ring->backend = lfs;
-  ring->mode = config->mode;
-  ring->file_size = config->file_size;
+#ifdef LFSRING_YES_EVENTS
+static void emit_event(lfsring_t* ring, enum lfsring_event_type type, const char* name,
+                       lfs_ssize_t value) {
+  if (ring->event_cb == NULL) {
+    return;
+  }
 
-  return 0;
+  lfsring_event_t event = { type, name, ring, 0, value };
+  if (ring->clock != NULL) {
+    event.time = ring->clock(ring->clock_ctx);
+  }
+  ring->event_cb(ring->event_ctx, &event);
 }
 
+#define LFSRING_EVENT_BEGIN(ring, name, value) emit_event(ring, LFSRING_EVENT_BEGIN, name, value)
+#define LFSRING_EVENT_END(ring, name, value) emit_event(ring, LFSRING_EVENT_END, name, value)
+#else
+#define LFSRING_EVENT_BEGIN(ring, name, value) ((void) 0)
+#define LFSRING_EVENT_END(ring, name, value) ((void) 0)
+#endif
+
 static inline uint64_t get_pos_r(lfsring_t* ring) {
   uint64_t low = lfs_fromle32(ring->attr_buf.le.read_low);
   uint64_t high = lfs_fromle32(ring->attr_buf.le.read_high);
@@ -44,17 +81,483 @@ static inline uint64_t get_pos_w(lfsring_t* ring) {
   return get_pos_r(ring) + lfs_fromle32(ring->attr_buf.le.write_dist);
 }
 
-static int do_write(lfsring_t* ring, const void* data, lfs_size_t sz, lfs_off_t rel_off) {
-  LFS_ASSERT(sz < ring->file_size);
+// Maps an absolute position to an offset within the file. Relocating the data
+// of an elastic ring buffer changes the base instead of the positions, which
+// therefore remain valid.
+static inline lfs_off_t get_file_offset(lfsring_t* ring, uint64_t pos) {
+  return (pos + lfs_fromle32(ring->attr_buf.le.base)) % ring->capacity;
+}
+
+#ifdef LFSRING_YES_HISTOGRAMS
+static void record_latency(lfsring_t* ring, enum lfsring_op op, uint32_t start) {
+  if (ring->clock == NULL) {
+    return;
+  }
+
+  uint32_t elapsed = ring->clock(ring->clock_ctx) - start;
+
+  // Bucket i > 0 counts durations of at least 2^(i-1) ticks.
+  unsigned int bucket = 0;
+  for (uint32_t e = elapsed; e != 0 && bucket < LFSRING_HISTOGRAM_BUCKETS - 1; e >>= 1) {
+    bucket++;
+  }
+
+  lfsring_histogram_t* histogram = &ring->histograms.ops[op];
+  histogram->count[bucket]++;
+  histogram->max = lfs_max(histogram->max, elapsed);
+}
+
+// Measures the duration of a public function call.
+struct timer {
+  uint32_t start;
+  uint64_t pos_r;
+};
+
+static inline struct timer start_timer(lfsring_t* ring) {
+  struct timer timer = { 0, get_pos_r(ring) };
+  if (ring->clock != NULL) {
+    timer.start = ring->clock(ring->clock_ctx);
+  }
+  return timer;
+}
+
+static inline void stop_timer(lfsring_t* ring, const struct timer* timer, enum lfsring_op op) {
+  // Appends that moved the read position forward had to overwrite data, which
+  // is usually much slower, so record them separately.
+  if (op == LFSRING_OP_APPEND && get_pos_r(ring) != timer->pos_r) {
+    op = LFSRING_OP_APPEND_OVERWRITE;
+  }
+  record_latency(ring, op, timer->start);
+}
+
+#define LFSRING_TIMER_START(ring) struct timer timer = start_timer(ring)
+#define LFSRING_TIMER_STOP(ring, op) stop_timer(ring, &timer, op)
+#else
+#define LFSRING_TIMER_START(ring) ((void) 0)
+#define LFSRING_TIMER_STOP(ring, op) ((void) 0)
+#endif
+
+// Updates the CRC-32C (Castagnoli) of a byte sequence with the given data. The
+// CRC instructions of SSE 4.2 and ARMv8 are used if the compiler targets them.
+static uint32_t crc32c(uint32_t crc, const void* data, lfs_size_t size) {
+  const uint8_t* p = (const uint8_t*) data;
+  crc = ~crc;
+
+#if defined(__SSE4_2__)
+#if defined(__x86_64__)
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc = (uint32_t) _mm_crc32_u64(crc, word);
+  }
+#endif
+  for (; size >= 4; size -= 4, p += 4) {
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    crc = _mm_crc32_u32(crc, word);
+  }
+  for (; size > 0; size--) {
+    crc = _mm_crc32_u8(crc, *p++);
+  }
+#elif defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; size > 0; size--) {
+    crc = __crc32cb(crc, *p++);
+  }
+#elif defined(LFSRING_YES_CRC_SLICE_BY_8)
+  // Table j maps a byte to its CRC after being followed by j zero bytes. The
+  // tables are constant, such that they can be placed in read-only memory.
+  static const uint32_t table[8][256] = {
+    {
+      0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c, 0x26a1e7e8, 0xd4ca64eb,
+      0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b, 0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24,
+      0x105ec76f, 0xe235446c, 0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+      0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc, 0xbc267848, 0x4e4dfb4b,
+      0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a, 0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35,
+      0xaa64d611, 0x580f5512, 0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+      0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad, 0x1642ae59, 0xe4292d5a,
+      0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a, 0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595,
+      0x417b1dbc, 0xb3109ebf, 0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+      0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f, 0xed03a29b, 0x1f682198,
+      0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927, 0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38,
+      0xdbfc821c, 0x2997011f, 0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+      0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e, 0x4767748a, 0xb50cf789,
+      0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859, 0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46,
+      0x7198540d, 0x83f3d70e, 0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+      0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de, 0xdde0eb2a, 0x2f8b6829,
+      0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c, 0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93,
+      0x082f63b7, 0xfa44e0b4, 0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+      0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b, 0xb4091bff, 0x466298fc,
+      0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c, 0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033,
+      0xa24bb5a6, 0x502036a5, 0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+      0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975, 0x0e330a81, 0xfc588982,
+      0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d, 0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622,
+      0x38cc2a06, 0xcaa7a905, 0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+      0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8, 0xe52cc12c, 0x1747422f,
+      0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff, 0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0,
+      0xd3d3e1ab, 0x21b862a8, 0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+      0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78, 0x7fab5e8c, 0x8dc0dd8f,
+      0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee, 0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1,
+      0x69e9f0d5, 0x9b8273d6, 0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+      0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
+      0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+    },
+    {
+      0x00000000, 0x13a29877, 0x274530ee, 0x34e7a899, 0x4e8a61dc, 0x5d28f9ab, 0x69cf5132, 0x7a6dc945,
+      0x9d14c3b8, 0x8eb65bcf, 0xba51f356, 0xa9f36b21, 0xd39ea264, 0xc03c3a13, 0xf4db928a, 0xe7790afd,
+      0x3fc5f181, 0x2c6769f6, 0x1880c16f, 0x0b225918, 0x714f905d, 0x62ed082a, 0x560aa0b3, 0x45a838c4,
+      0xa2d13239, 0xb173aa4e, 0x859402d7, 0x96369aa0, 0xec5b53e5, 0xfff9cb92, 0xcb1e630b, 0xd8bcfb7c,
+      0x7f8be302, 0x6c297b75, 0x58ced3ec, 0x4b6c4b9b, 0x310182de, 0x22a31aa9, 0x1644b230, 0x05e62a47,
+      0xe29f20ba, 0xf13db8cd, 0xc5da1054, 0xd6788823, 0xac154166, 0xbfb7d911, 0x8b507188, 0x98f2e9ff,
+      0x404e1283, 0x53ec8af4, 0x670b226d, 0x74a9ba1a, 0x0ec4735f, 0x1d66eb28, 0x298143b1, 0x3a23dbc6,
+      0xdd5ad13b, 0xcef8494c, 0xfa1fe1d5, 0xe9bd79a2, 0x93d0b0e7, 0x80722890, 0xb4958009, 0xa737187e,
+      0xff17c604, 0xecb55e73, 0xd852f6ea, 0xcbf06e9d, 0xb19da7d8, 0xa23f3faf, 0x96d89736, 0x857a0f41,
+      0x620305bc, 0x71a19dcb, 0x45463552, 0x56e4ad25, 0x2c896460, 0x3f2bfc17, 0x0bcc548e, 0x186eccf9,
+      0xc0d23785, 0xd370aff2, 0xe797076b, 0xf4359f1c, 0x8e585659, 0x9dface2e, 0xa91d66b7, 0xbabffec0,
+      0x5dc6f43d, 0x4e646c4a, 0x7a83c4d3, 0x69215ca4, 0x134c95e1, 0x00ee0d96, 0x3409a50f, 0x27ab3d78,
+      0x809c2506, 0x933ebd71, 0xa7d915e8, 0xb47b8d9f, 0xce1644da, 0xddb4dcad, 0xe9537434, 0xfaf1ec43,
+      0x1d88e6be, 0x0e2a7ec9, 0x3acdd650, 0x296f4e27, 0x53028762, 0x40a01f15, 0x7447b78c, 0x67e52ffb,
+      0xbf59d487, 0xacfb4cf0, 0x981ce469, 0x8bbe7c1e, 0xf1d3b55b, 0xe2712d2c, 0xd69685b5, 0xc5341dc2,
+      0x224d173f, 0x31ef8f48, 0x050827d1, 0x16aabfa6, 0x6cc776e3, 0x7f65ee94, 0x4b82460d, 0x5820de7a,
+      0xfbc3faf9, 0xe861628e, 0xdc86ca17, 0xcf245260, 0xb5499b25, 0xa6eb0352, 0x920cabcb, 0x81ae33bc,
+      0x66d73941, 0x7575a136, 0x419209af, 0x523091d8, 0x285d589d, 0x3bffc0ea, 0x0f186873, 0x1cbaf004,
+      0xc4060b78, 0xd7a4930f, 0xe3433b96, 0xf0e1a3e1, 0x8a8c6aa4, 0x992ef2d3, 0xadc95a4a, 0xbe6bc23d,
+      0x5912c8c0, 0x4ab050b7, 0x7e57f82e, 0x6df56059, 0x1798a91c, 0x043a316b, 0x30dd99f2, 0x237f0185,
+      0x844819fb, 0x97ea818c, 0xa30d2915, 0xb0afb162, 0xcac27827, 0xd960e050, 0xed8748c9, 0xfe25d0be,
+      0x195cda43, 0x0afe4234, 0x3e19eaad, 0x2dbb72da, 0x57d6bb9f, 0x447423e8, 0x70938b71, 0x63311306,
+      0xbb8de87a, 0xa82f700d, 0x9cc8d894, 0x8f6a40e3, 0xf50789a6, 0xe6a511d1, 0xd242b948, 0xc1e0213f,
+      0x26992bc2, 0x353bb3b5, 0x01dc1b2c, 0x127e835b, 0x68134a1e, 0x7bb1d269, 0x4f567af0, 0x5cf4e287,
+      0x04d43cfd, 0x1776a48a, 0x23910c13, 0x30339464, 0x4a5e5d21, 0x59fcc556, 0x6d1b6dcf, 0x7eb9f5b8,
+      0x99c0ff45, 0x8a626732, 0xbe85cfab, 0xad2757dc, 0xd74a9e99, 0xc4e806ee, 0xf00fae77, 0xe3ad3600,
+      0x3b11cd7c, 0x28b3550b, 0x1c54fd92, 0x0ff665e5, 0x759baca0, 0x663934d7, 0x52de9c4e, 0x417c0439,
+      0xa6050ec4, 0xb5a796b3, 0x81403e2a, 0x92e2a65d, 0xe88f6f18, 0xfb2df76f, 0xcfca5ff6, 0xdc68c781,
+      0x7b5fdfff, 0x68fd4788, 0x5c1aef11, 0x4fb87766, 0x35d5be23, 0x26772654, 0x12908ecd, 0x013216ba,
+      0xe64b1c47, 0xf5e98430, 0xc10e2ca9, 0xd2acb4de, 0xa8c17d9b, 0xbb63e5ec, 0x8f844d75, 0x9c26d502,
+      0x449a2e7e, 0x5738b609, 0x63df1e90, 0x707d86e7, 0x0a104fa2, 0x19b2d7d5, 0x2d557f4c, 0x3ef7e73b,
+      0xd98eedc6, 0xca2c75b1, 0xfecbdd28, 0xed69455f, 0x97048c1a, 0x84a6146d, 0xb041bcf4, 0xa3e32483
+    },
+    {
+      0x00000000, 0xa541927e, 0x4f6f520d, 0xea2ec073, 0x9edea41a, 0x3b9f3664, 0xd1b1f617, 0x74f06469,
+      0x38513ec5, 0x9d10acbb, 0x773e6cc8, 0xd27ffeb6, 0xa68f9adf, 0x03ce08a1, 0xe9e0c8d2, 0x4ca15aac,
+      0x70a27d8a, 0xd5e3eff4, 0x3fcd2f87, 0x9a8cbdf9, 0xee7cd990, 0x4b3d4bee, 0xa1138b9d, 0x045219e3,
+      0x48f3434f, 0xedb2d131, 0x079c1142, 0xa2dd833c, 0xd62de755, 0x736c752b, 0x9942b558, 0x3c032726,
+      0xe144fb14, 0x4405696a, 0xae2ba919, 0x0b6a3b67, 0x7f9a5f0e, 0xdadbcd70, 0x30f50d03, 0x95b49f7d,
+      0xd915c5d1, 0x7c5457af, 0x967a97dc, 0x333b05a2, 0x47cb61cb, 0xe28af3b5, 0x08a433c6, 0xade5a1b8,
+      0x91e6869e, 0x34a714e0, 0xde89d493, 0x7bc846ed, 0x0f382284, 0xaa79b0fa, 0x40577089, 0xe516e2f7,
+      0xa9b7b85b, 0x0cf62a25, 0xe6d8ea56, 0x43997828, 0x37691c41, 0x92288e3f, 0x78064e4c, 0xdd47dc32,
+      0xc76580d9, 0x622412a7, 0x880ad2d4, 0x2d4b40aa, 0x59bb24c3, 0xfcfab6bd, 0x16d476ce, 0xb395e4b0,
+      0xff34be1c, 0x5a752c62, 0xb05bec11, 0x151a7e6f, 0x61ea1a06, 0xc4ab8878, 0x2e85480b, 0x8bc4da75,
+      0xb7c7fd53, 0x12866f2d, 0xf8a8af5e, 0x5de93d20, 0x29195949, 0x8c58cb37, 0x66760b44, 0xc337993a,
+      0x8f96c396, 0x2ad751e8, 0xc0f9919b, 0x65b803e5, 0x1148678c, 0xb409f5f2, 0x5e273581, 0xfb66a7ff,
+      0x26217bcd, 0x8360e9b3, 0x694e29c0, 0xcc0fbbbe, 0xb8ffdfd7, 0x1dbe4da9, 0xf7908dda, 0x52d11fa4,
+      0x1e704508, 0xbb31d776, 0x511f1705, 0xf45e857b, 0x80aee112, 0x25ef736c, 0xcfc1b31f, 0x6a802161,
+      0x56830647, 0xf3c29439, 0x19ec544a, 0xbcadc634, 0xc85da25d, 0x6d1c3023, 0x8732f050, 0x2273622e,
+      0x6ed23882, 0xcb93aafc, 0x21bd6a8f, 0x84fcf8f1, 0xf00c9c98, 0x554d0ee6, 0xbf63ce95, 0x1a225ceb,
+      0x8b277743, 0x2e66e53d, 0xc448254e, 0x6109b730, 0x15f9d359, 0xb0b84127, 0x5a968154, 0xffd7132a,
+      0xb3764986, 0x1637dbf8, 0xfc191b8b, 0x595889f5, 0x2da8ed9c, 0x88e97fe2, 0x62c7bf91, 0xc7862def,
+      0xfb850ac9, 0x5ec498b7, 0xb4ea58c4, 0x11abcaba, 0x655baed3, 0xc01a3cad, 0x2a34fcde, 0x8f756ea0,
+      0xc3d4340c, 0x6695a672, 0x8cbb6601, 0x29faf47f, 0x5d0a9016, 0xf84b0268, 0x1265c21b, 0xb7245065,
+      0x6a638c57, 0xcf221e29, 0x250cde5a, 0x804d4c24, 0xf4bd284d, 0x51fcba33, 0xbbd27a40, 0x1e93e83e,
+      0x5232b292, 0xf77320ec, 0x1d5de09f, 0xb81c72e1, 0xccec1688, 0x69ad84f6, 0x83834485, 0x26c2d6fb,
+      0x1ac1f1dd, 0xbf8063a3, 0x55aea3d0, 0xf0ef31ae, 0x841f55c7, 0x215ec7b9, 0xcb7007ca, 0x6e3195b4,
+      0x2290cf18, 0x87d15d66, 0x6dff9d15, 0xc8be0f6b, 0xbc4e6b02, 0x190ff97c, 0xf321390f, 0x5660ab71,
+      0x4c42f79a, 0xe90365e4, 0x032da597, 0xa66c37e9, 0xd29c5380, 0x77ddc1fe, 0x9df3018d, 0x38b293f3,
+      0x7413c95f, 0xd1525b21, 0x3b7c9b52, 0x9e3d092c, 0xeacd6d45, 0x4f8cff3b, 0xa5a23f48, 0x00e3ad36,
+      0x3ce08a10, 0x99a1186e, 0x738fd81d, 0xd6ce4a63, 0xa23e2e0a, 0x077fbc74, 0xed517c07, 0x4810ee79,
+      0x04b1b4d5, 0xa1f026ab, 0x4bdee6d8, 0xee9f74a6, 0x9a6f10cf, 0x3f2e82b1, 0xd50042c2, 0x7041d0bc,
+      0xad060c8e, 0x08479ef0, 0xe2695e83, 0x4728ccfd, 0x33d8a894, 0x96993aea, 0x7cb7fa99, 0xd9f668e7,
+      0x9557324b, 0x3016a035, 0xda386046, 0x7f79f238, 0x0b899651, 0xaec8042f, 0x44e6c45c, 0xe1a75622,
+      0xdda47104, 0x78e5e37a, 0x92cb2309, 0x378ab177, 0x437ad51e, 0xe63b4760, 0x0c158713, 0xa954156d,
+      0xe5f54fc1, 0x40b4ddbf, 0xaa9a1dcc, 0x0fdb8fb2, 0x7b2bebdb, 0xde6a79a5, 0x3444b9d6, 0x91052ba8
+    },
+    {
+      0x00000000, 0xdd45aab8, 0xbf672381, 0x62228939, 0x7b2231f3, 0xa6679b4b, 0xc4451272, 0x1900b8ca,
+      0xf64463e6, 0x2b01c95e, 0x49234067, 0x9466eadf, 0x8d665215, 0x5023f8ad, 0x32017194, 0xef44db2c,
+      0xe964b13d, 0x34211b85, 0x560392bc, 0x8b463804, 0x924680ce, 0x4f032a76, 0x2d21a34f, 0xf06409f7,
+      0x1f20d2db, 0xc2657863, 0xa047f15a, 0x7d025be2, 0x6402e328, 0xb9474990, 0xdb65c0a9, 0x06206a11,
+      0xd725148b, 0x0a60be33, 0x6842370a, 0xb5079db2, 0xac072578, 0x71428fc0, 0x136006f9, 0xce25ac41,
+      0x2161776d, 0xfc24ddd5, 0x9e0654ec, 0x4343fe54, 0x5a43469e, 0x8706ec26, 0xe524651f, 0x3861cfa7,
+      0x3e41a5b6, 0xe3040f0e, 0x81268637, 0x5c632c8f, 0x45639445, 0x98263efd, 0xfa04b7c4, 0x27411d7c,
+      0xc805c650, 0x15406ce8, 0x7762e5d1, 0xaa274f69, 0xb327f7a3, 0x6e625d1b, 0x0c40d422, 0xd1057e9a,
+      0xaba65fe7, 0x76e3f55f, 0x14c17c66, 0xc984d6de, 0xd0846e14, 0x0dc1c4ac, 0x6fe34d95, 0xb2a6e72d,
+      0x5de23c01, 0x80a796b9, 0xe2851f80, 0x3fc0b538, 0x26c00df2, 0xfb85a74a, 0x99a72e73, 0x44e284cb,
+      0x42c2eeda, 0x9f874462, 0xfda5cd5b, 0x20e067e3, 0x39e0df29, 0xe4a57591, 0x8687fca8, 0x5bc25610,
+      0xb4868d3c, 0x69c32784, 0x0be1aebd, 0xd6a40405, 0xcfa4bccf, 0x12e11677, 0x70c39f4e, 0xad8635f6,
+      0x7c834b6c, 0xa1c6e1d4, 0xc3e468ed, 0x1ea1c255, 0x07a17a9f, 0xdae4d027, 0xb8c6591e, 0x6583f3a6,
+      0x8ac7288a, 0x57828232, 0x35a00b0b, 0xe8e5a1b3, 0xf1e51979, 0x2ca0b3c1, 0x4e823af8, 0x93c79040,
+      0x95e7fa51, 0x48a250e9, 0x2a80d9d0, 0xf7c57368, 0xeec5cba2, 0x3380611a, 0x51a2e823, 0x8ce7429b,
+      0x63a399b7, 0xbee6330f, 0xdcc4ba36, 0x0181108e, 0x1881a844, 0xc5c402fc, 0xa7e68bc5, 0x7aa3217d,
+      0x52a0c93f, 0x8fe56387, 0xedc7eabe, 0x30824006, 0x2982f8cc, 0xf4c75274, 0x96e5db4d, 0x4ba071f5,
+      0xa4e4aad9, 0x79a10061, 0x1b838958, 0xc6c623e0, 0xdfc69b2a, 0x02833192, 0x60a1b8ab, 0xbde41213,
+      0xbbc47802, 0x6681d2ba, 0x04a35b83, 0xd9e6f13b, 0xc0e649f1, 0x1da3e349, 0x7f816a70, 0xa2c4c0c8,
+      0x4d801be4, 0x90c5b15c, 0xf2e73865, 0x2fa292dd, 0x36a22a17, 0xebe780af, 0x89c50996, 0x5480a32e,
+      0x8585ddb4, 0x58c0770c, 0x3ae2fe35, 0xe7a7548d, 0xfea7ec47, 0x23e246ff, 0x41c0cfc6, 0x9c85657e,
+      0x73c1be52, 0xae8414ea, 0xcca69dd3, 0x11e3376b, 0x08e38fa1, 0xd5a62519, 0xb784ac20, 0x6ac10698,
+      0x6ce16c89, 0xb1a4c631, 0xd3864f08, 0x0ec3e5b0, 0x17c35d7a, 0xca86f7c2, 0xa8a47efb, 0x75e1d443,
+      0x9aa50f6f, 0x47e0a5d7, 0x25c22cee, 0xf8878656, 0xe1873e9c, 0x3cc29424, 0x5ee01d1d, 0x83a5b7a5,
+      0xf90696d8, 0x24433c60, 0x4661b559, 0x9b241fe1, 0x8224a72b, 0x5f610d93, 0x3d4384aa, 0xe0062e12,
+      0x0f42f53e, 0xd2075f86, 0xb025d6bf, 0x6d607c07, 0x7460c4cd, 0xa9256e75, 0xcb07e74c, 0x16424df4,
+      0x106227e5, 0xcd278d5d, 0xaf050464, 0x7240aedc, 0x6b401616, 0xb605bcae, 0xd4273597, 0x09629f2f,
+      0xe6264403, 0x3b63eebb, 0x59416782, 0x8404cd3a, 0x9d0475f0, 0x4041df48, 0x22635671, 0xff26fcc9,
+      0x2e238253, 0xf36628eb, 0x9144a1d2, 0x4c010b6a, 0x5501b3a0, 0x88441918, 0xea669021, 0x37233a99,
+      0xd867e1b5, 0x05224b0d, 0x6700c234, 0xba45688c, 0xa345d046, 0x7e007afe, 0x1c22f3c7, 0xc167597f,
+      0xc747336e, 0x1a0299d6, 0x782010ef, 0xa565ba57, 0xbc65029d, 0x6120a825, 0x0302211c, 0xde478ba4,
+      0x31035088, 0xec46fa30, 0x8e647309, 0x5321d9b1, 0x4a21617b, 0x9764cbc3, 0xf54642fa, 0x2803e842
+    },
+    {
+      0x00000000, 0x38116fac, 0x7022df58, 0x4833b0f4, 0xe045beb0, 0xd854d11c, 0x906761e8, 0xa8760e44,
+      0xc5670b91, 0xfd76643d, 0xb545d4c9, 0x8d54bb65, 0x2522b521, 0x1d33da8d, 0x55006a79, 0x6d1105d5,
+      0x8f2261d3, 0xb7330e7f, 0xff00be8b, 0xc711d127, 0x6f67df63, 0x5776b0cf, 0x1f45003b, 0x27546f97,
+      0x4a456a42, 0x725405ee, 0x3a67b51a, 0x0276dab6, 0xaa00d4f2, 0x9211bb5e, 0xda220baa, 0xe2336406,
+      0x1ba8b557, 0x23b9dafb, 0x6b8a6a0f, 0x539b05a3, 0xfbed0be7, 0xc3fc644b, 0x8bcfd4bf, 0xb3debb13,
+      0xdecfbec6, 0xe6ded16a, 0xaeed619e, 0x96fc0e32, 0x3e8a0076, 0x069b6fda, 0x4ea8df2e, 0x76b9b082,
+      0x948ad484, 0xac9bbb28, 0xe4a80bdc, 0xdcb96470, 0x74cf6a34, 0x4cde0598, 0x04edb56c, 0x3cfcdac0,
+      0x51eddf15, 0x69fcb0b9, 0x21cf004d, 0x19de6fe1, 0xb1a861a5, 0x89b90e09, 0xc18abefd, 0xf99bd151,
+      0x37516aae, 0x0f400502, 0x4773b5f6, 0x7f62da5a, 0xd714d41e, 0xef05bbb2, 0xa7360b46, 0x9f2764ea,
+      0xf236613f, 0xca270e93, 0x8214be67, 0xba05d1cb, 0x1273df8f, 0x2a62b023, 0x625100d7, 0x5a406f7b,
+      0xb8730b7d, 0x806264d1, 0xc851d425, 0xf040bb89, 0x5836b5cd, 0x6027da61, 0x28146a95, 0x10050539,
+      0x7d1400ec, 0x45056f40, 0x0d36dfb4, 0x3527b018, 0x9d51be5c, 0xa540d1f0, 0xed736104, 0xd5620ea8,
+      0x2cf9dff9, 0x14e8b055, 0x5cdb00a1, 0x64ca6f0d, 0xccbc6149, 0xf4ad0ee5, 0xbc9ebe11, 0x848fd1bd,
+      0xe99ed468, 0xd18fbbc4, 0x99bc0b30, 0xa1ad649c, 0x09db6ad8, 0x31ca0574, 0x79f9b580, 0x41e8da2c,
+      0xa3dbbe2a, 0x9bcad186, 0xd3f96172, 0xebe80ede, 0x439e009a, 0x7b8f6f36, 0x33bcdfc2, 0x0badb06e,
+      0x66bcb5bb, 0x5eadda17, 0x169e6ae3, 0x2e8f054f, 0x86f90b0b, 0xbee864a7, 0xf6dbd453, 0xcecabbff,
+      0x6ea2d55c, 0x56b3baf0, 0x1e800a04, 0x269165a8, 0x8ee76bec, 0xb6f60440, 0xfec5b4b4, 0xc6d4db18,
+      0xabc5decd, 0x93d4b161, 0xdbe70195, 0xe3f66e39, 0x4b80607d, 0x73910fd1, 0x3ba2bf25, 0x03b3d089,
+      0xe180b48f, 0xd991db23, 0x91a26bd7, 0xa9b3047b, 0x01c50a3f, 0x39d46593, 0x71e7d567, 0x49f6bacb,
+      0x24e7bf1e, 0x1cf6d0b2, 0x54c56046, 0x6cd40fea, 0xc4a201ae, 0xfcb36e02, 0xb480def6, 0x8c91b15a,
+      0x750a600b, 0x4d1b0fa7, 0x0528bf53, 0x3d39d0ff, 0x954fdebb, 0xad5eb117, 0xe56d01e3, 0xdd7c6e4f,
+      0xb06d6b9a, 0x887c0436, 0xc04fb4c2, 0xf85edb6e, 0x5028d52a, 0x6839ba86, 0x200a0a72, 0x181b65de,
+      0xfa2801d8, 0xc2396e74, 0x8a0ade80, 0xb21bb12c, 0x1a6dbf68, 0x227cd0c4, 0x6a4f6030, 0x525e0f9c,
+      0x3f4f0a49, 0x075e65e5, 0x4f6dd511, 0x777cbabd, 0xdf0ab4f9, 0xe71bdb55, 0xaf286ba1, 0x9739040d,
+      0x59f3bff2, 0x61e2d05e, 0x29d160aa, 0x11c00f06, 0xb9b60142, 0x81a76eee, 0xc994de1a, 0xf185b1b6,
+      0x9c94b463, 0xa485dbcf, 0xecb66b3b, 0xd4a70497, 0x7cd10ad3, 0x44c0657f, 0x0cf3d58b, 0x34e2ba27,
+      0xd6d1de21, 0xeec0b18d, 0xa6f30179, 0x9ee26ed5, 0x36946091, 0x0e850f3d, 0x46b6bfc9, 0x7ea7d065,
+      0x13b6d5b0, 0x2ba7ba1c, 0x63940ae8, 0x5b856544, 0xf3f36b00, 0xcbe204ac, 0x83d1b458, 0xbbc0dbf4,
+      0x425b0aa5, 0x7a4a6509, 0x3279d5fd, 0x0a68ba51, 0xa21eb415, 0x9a0fdbb9, 0xd23c6b4d, 0xea2d04e1,
+      0x873c0134, 0xbf2d6e98, 0xf71ede6c, 0xcf0fb1c0, 0x6779bf84, 0x5f68d028, 0x175b60dc, 0x2f4a0f70,
+      0xcd796b76, 0xf56804da, 0xbd5bb42e, 0x854adb82, 0x2d3cd5c6, 0x152dba6a, 0x5d1e0a9e, 0x650f6532,
+      0x081e60e7, 0x300f0f4b, 0x783cbfbf, 0x402dd013, 0xe85bde57, 0xd04ab1fb, 0x9879010f, 0xa0686ea3
+    },
+    {
+      0x00000000, 0xef306b19, 0xdb8ca0c3, 0x34bccbda, 0xb2f53777, 0x5dc55c6e, 0x697997b4, 0x8649fcad,
+      0x6006181f, 0x8f367306, 0xbb8ab8dc, 0x54bad3c5, 0xd2f32f68, 0x3dc34471, 0x097f8fab, 0xe64fe4b2,
+      0xc00c303e, 0x2f3c5b27, 0x1b8090fd, 0xf4b0fbe4, 0x72f90749, 0x9dc96c50, 0xa975a78a, 0x4645cc93,
+      0xa00a2821, 0x4f3a4338, 0x7b8688e2, 0x94b6e3fb, 0x12ff1f56, 0xfdcf744f, 0xc973bf95, 0x2643d48c,
+      0x85f4168d, 0x6ac47d94, 0x5e78b64e, 0xb148dd57, 0x370121fa, 0xd8314ae3, 0xec8d8139, 0x03bdea20,
+      0xe5f20e92, 0x0ac2658b, 0x3e7eae51, 0xd14ec548, 0x570739e5, 0xb83752fc, 0x8c8b9926, 0x63bbf23f,
+      0x45f826b3, 0xaac84daa, 0x9e748670, 0x7144ed69, 0xf70d11c4, 0x183d7add, 0x2c81b107, 0xc3b1da1e,
+      0x25fe3eac, 0xcace55b5, 0xfe729e6f, 0x1142f576, 0x970b09db, 0x783b62c2, 0x4c87a918, 0xa3b7c201,
+      0x0e045beb, 0xe13430f2, 0xd588fb28, 0x3ab89031, 0xbcf16c9c, 0x53c10785, 0x677dcc5f, 0x884da746,
+      0x6e0243f4, 0x813228ed, 0xb58ee337, 0x5abe882e, 0xdcf77483, 0x33c71f9a, 0x077bd440, 0xe84bbf59,
+      0xce086bd5, 0x213800cc, 0x1584cb16, 0xfab4a00f, 0x7cfd5ca2, 0x93cd37bb, 0xa771fc61, 0x48419778,
+      0xae0e73ca, 0x413e18d3, 0x7582d309, 0x9ab2b810, 0x1cfb44bd, 0xf3cb2fa4, 0xc777e47e, 0x28478f67,
+      0x8bf04d66, 0x64c0267f, 0x507ceda5, 0xbf4c86bc, 0x39057a11, 0xd6351108, 0xe289dad2, 0x0db9b1cb,
+      0xebf65579, 0x04c63e60, 0x307af5ba, 0xdf4a9ea3, 0x5903620e, 0xb6330917, 0x828fc2cd, 0x6dbfa9d4,
+      0x4bfc7d58, 0xa4cc1641, 0x9070dd9b, 0x7f40b682, 0xf9094a2f, 0x16392136, 0x2285eaec, 0xcdb581f5,
+      0x2bfa6547, 0xc4ca0e5e, 0xf076c584, 0x1f46ae9d, 0x990f5230, 0x763f3929, 0x4283f2f3, 0xadb399ea,
+      0x1c08b7d6, 0xf338dccf, 0xc7841715, 0x28b47c0c, 0xaefd80a1, 0x41cdebb8, 0x75712062, 0x9a414b7b,
+      0x7c0eafc9, 0x933ec4d0, 0xa7820f0a, 0x48b26413, 0xcefb98be, 0x21cbf3a7, 0x1577387d, 0xfa475364,
+      0xdc0487e8, 0x3334ecf1, 0x0788272b, 0xe8b84c32, 0x6ef1b09f, 0x81c1db86, 0xb57d105c, 0x5a4d7b45,
+      0xbc029ff7, 0x5332f4ee, 0x678e3f34, 0x88be542d, 0x0ef7a880, 0xe1c7c399, 0xd57b0843, 0x3a4b635a,
+      0x99fca15b, 0x76ccca42, 0x42700198, 0xad406a81, 0x2b09962c, 0xc439fd35, 0xf08536ef, 0x1fb55df6,
+      0xf9fab944, 0x16cad25d, 0x22761987, 0xcd46729e, 0x4b0f8e33, 0xa43fe52a, 0x90832ef0, 0x7fb345e9,
+      0x59f09165, 0xb6c0fa7c, 0x827c31a6, 0x6d4c5abf, 0xeb05a612, 0x0435cd0b, 0x308906d1, 0xdfb96dc8,
+      0x39f6897a, 0xd6c6e263, 0xe27a29b9, 0x0d4a42a0, 0x8b03be0d, 0x6433d514, 0x508f1ece, 0xbfbf75d7,
+      0x120cec3d, 0xfd3c8724, 0xc9804cfe, 0x26b027e7, 0xa0f9db4a, 0x4fc9b053, 0x7b757b89, 0x94451090,
+      0x720af422, 0x9d3a9f3b, 0xa98654e1, 0x46b63ff8, 0xc0ffc355, 0x2fcfa84c, 0x1b736396, 0xf443088f,
+      0xd200dc03, 0x3d30b71a, 0x098c7cc0, 0xe6bc17d9, 0x60f5eb74, 0x8fc5806d, 0xbb794bb7, 0x544920ae,
+      0xb206c41c, 0x5d36af05, 0x698a64df, 0x86ba0fc6, 0x00f3f36b, 0xefc39872, 0xdb7f53a8, 0x344f38b1,
+      0x97f8fab0, 0x78c891a9, 0x4c745a73, 0xa344316a, 0x250dcdc7, 0xca3da6de, 0xfe816d04, 0x11b1061d,
+      0xf7fee2af, 0x18ce89b6, 0x2c72426c, 0xc3422975, 0x450bd5d8, 0xaa3bbec1, 0x9e87751b, 0x71b71e02,
+      0x57f4ca8e, 0xb8c4a197, 0x8c786a4d, 0x63480154, 0xe501fdf9, 0x0a3196e0, 0x3e8d5d3a, 0xd1bd3623,
+      0x37f2d291, 0xd8c2b988, 0xec7e7252, 0x034e194b, 0x8507e5e6, 0x6a378eff, 0x5e8b4525, 0xb1bb2e3c
+    },
+    {
+      0x00000000, 0x68032cc8, 0xd0065990, 0xb8057558, 0xa5e0c5d1, 0xcde3e919, 0x75e69c41, 0x1de5b089,
+      0x4e2dfd53, 0x262ed19b, 0x9e2ba4c3, 0xf628880b, 0xebcd3882, 0x83ce144a, 0x3bcb6112, 0x53c84dda,
+      0x9c5bfaa6, 0xf458d66e, 0x4c5da336, 0x245e8ffe, 0x39bb3f77, 0x51b813bf, 0xe9bd66e7, 0x81be4a2f,
+      0xd27607f5, 0xba752b3d, 0x02705e65, 0x6a7372ad, 0x7796c224, 0x1f95eeec, 0xa7909bb4, 0xcf93b77c,
+      0x3d5b83bd, 0x5558af75, 0xed5dda2d, 0x855ef6e5, 0x98bb466c, 0xf0b86aa4, 0x48bd1ffc, 0x20be3334,
+      0x73767eee, 0x1b755226, 0xa370277e, 0xcb730bb6, 0xd696bb3f, 0xbe9597f7, 0x0690e2af, 0x6e93ce67,
+      0xa100791b, 0xc90355d3, 0x7106208b, 0x19050c43, 0x04e0bcca, 0x6ce39002, 0xd4e6e55a, 0xbce5c992,
+      0xef2d8448, 0x872ea880, 0x3f2bddd8, 0x5728f110, 0x4acd4199, 0x22ce6d51, 0x9acb1809, 0xf2c834c1,
+      0x7ab7077a, 0x12b42bb2, 0xaab15eea, 0xc2b27222, 0xdf57c2ab, 0xb754ee63, 0x0f519b3b, 0x6752b7f3,
+      0x349afa29, 0x5c99d6e1, 0xe49ca3b9, 0x8c9f8f71, 0x917a3ff8, 0xf9791330, 0x417c6668, 0x297f4aa0,
+      0xe6ecfddc, 0x8eefd114, 0x36eaa44c, 0x5ee98884, 0x430c380d, 0x2b0f14c5, 0x930a619d, 0xfb094d55,
+      0xa8c1008f, 0xc0c22c47, 0x78c7591f, 0x10c475d7, 0x0d21c55e, 0x6522e996, 0xdd279cce, 0xb524b006,
+      0x47ec84c7, 0x2fefa80f, 0x97eadd57, 0xffe9f19f, 0xe20c4116, 0x8a0f6dde, 0x320a1886, 0x5a09344e,
+      0x09c17994, 0x61c2555c, 0xd9c72004, 0xb1c40ccc, 0xac21bc45, 0xc422908d, 0x7c27e5d5, 0x1424c91d,
+      0xdbb77e61, 0xb3b452a9, 0x0bb127f1, 0x63b20b39, 0x7e57bbb0, 0x16549778, 0xae51e220, 0xc652cee8,
+      0x959a8332, 0xfd99affa, 0x459cdaa2, 0x2d9ff66a, 0x307a46e3, 0x58796a2b, 0xe07c1f73, 0x887f33bb,
+      0xf56e0ef4, 0x9d6d223c, 0x25685764, 0x4d6b7bac, 0x508ecb25, 0x388de7ed, 0x808892b5, 0xe88bbe7d,
+      0xbb43f3a7, 0xd340df6f, 0x6b45aa37, 0x034686ff, 0x1ea33676, 0x76a01abe, 0xcea56fe6, 0xa6a6432e,
+      0x6935f452, 0x0136d89a, 0xb933adc2, 0xd130810a, 0xccd53183, 0xa4d61d4b, 0x1cd36813, 0x74d044db,
+      0x27180901, 0x4f1b25c9, 0xf71e5091, 0x9f1d7c59, 0x82f8ccd0, 0xeafbe018, 0x52fe9540, 0x3afdb988,
+      0xc8358d49, 0xa036a181, 0x1833d4d9, 0x7030f811, 0x6dd54898, 0x05d66450, 0xbdd31108, 0xd5d03dc0,
+      0x8618701a, 0xee1b5cd2, 0x561e298a, 0x3e1d0542, 0x23f8b5cb, 0x4bfb9903, 0xf3feec5b, 0x9bfdc093,
+      0x546e77ef, 0x3c6d5b27, 0x84682e7f, 0xec6b02b7, 0xf18eb23e, 0x998d9ef6, 0x2188ebae, 0x498bc766,
+      0x1a438abc, 0x7240a674, 0xca45d32c, 0xa246ffe4, 0xbfa34f6d, 0xd7a063a5, 0x6fa516fd, 0x07a63a35,
+      0x8fd9098e, 0xe7da2546, 0x5fdf501e, 0x37dc7cd6, 0x2a39cc5f, 0x423ae097, 0xfa3f95cf, 0x923cb907,
+      0xc1f4f4dd, 0xa9f7d815, 0x11f2ad4d, 0x79f18185, 0x6414310c, 0x0c171dc4, 0xb412689c, 0xdc114454,
+      0x1382f328, 0x7b81dfe0, 0xc384aab8, 0xab878670, 0xb66236f9, 0xde611a31, 0x66646f69, 0x0e6743a1,
+      0x5daf0e7b, 0x35ac22b3, 0x8da957eb, 0xe5aa7b23, 0xf84fcbaa, 0x904ce762, 0x2849923a, 0x404abef2,
+      0xb2828a33, 0xda81a6fb, 0x6284d3a3, 0x0a87ff6b, 0x17624fe2, 0x7f61632a, 0xc7641672, 0xaf673aba,
+      0xfcaf7760, 0x94ac5ba8, 0x2ca92ef0, 0x44aa0238, 0x594fb2b1, 0x314c9e79, 0x8949eb21, 0xe14ac7e9,
+      0x2ed97095, 0x46da5c5d, 0xfedf2905, 0x96dc05cd, 0x8b39b544, 0xe33a998c, 0x5b3fecd4, 0x333cc01c,
+      0x60f48dc6, 0x08f7a10e, 0xb0f2d456, 0xd8f1f89e, 0xc5144817, 0xad1764df, 0x15121187, 0x7d113d4f
+    },
+    {
+      0x00000000, 0x493c7d27, 0x9278fa4e, 0xdb448769, 0x211d826d, 0x6821ff4a, 0xb3657823, 0xfa590504,
+      0x423b04da, 0x0b0779fd, 0xd043fe94, 0x997f83b3, 0x632686b7, 0x2a1afb90, 0xf15e7cf9, 0xb86201de,
+      0x847609b4, 0xcd4a7493, 0x160ef3fa, 0x5f328edd, 0xa56b8bd9, 0xec57f6fe, 0x37137197, 0x7e2f0cb0,
+      0xc64d0d6e, 0x8f717049, 0x5435f720, 0x1d098a07, 0xe7508f03, 0xae6cf224, 0x7528754d, 0x3c14086a,
+      0x0d006599, 0x443c18be, 0x9f789fd7, 0xd644e2f0, 0x2c1de7f4, 0x65219ad3, 0xbe651dba, 0xf759609d,
+      0x4f3b6143, 0x06071c64, 0xdd439b0d, 0x947fe62a, 0x6e26e32e, 0x271a9e09, 0xfc5e1960, 0xb5626447,
+      0x89766c2d, 0xc04a110a, 0x1b0e9663, 0x5232eb44, 0xa86bee40, 0xe1579367, 0x3a13140e, 0x732f6929,
+      0xcb4d68f7, 0x827115d0, 0x593592b9, 0x1009ef9e, 0xea50ea9a, 0xa36c97bd, 0x782810d4, 0x31146df3,
+      0x1a00cb32, 0x533cb615, 0x8878317c, 0xc1444c5b, 0x3b1d495f, 0x72213478, 0xa965b311, 0xe059ce36,
+      0x583bcfe8, 0x1107b2cf, 0xca4335a6, 0x837f4881, 0x79264d85, 0x301a30a2, 0xeb5eb7cb, 0xa262caec,
+      0x9e76c286, 0xd74abfa1, 0x0c0e38c8, 0x453245ef, 0xbf6b40eb, 0xf6573dcc, 0x2d13baa5, 0x642fc782,
+      0xdc4dc65c, 0x9571bb7b, 0x4e353c12, 0x07094135, 0xfd504431, 0xb46c3916, 0x6f28be7f, 0x2614c358,
+      0x1700aeab, 0x5e3cd38c, 0x857854e5, 0xcc4429c2, 0x361d2cc6, 0x7f2151e1, 0xa465d688, 0xed59abaf,
+      0x553baa71, 0x1c07d756, 0xc743503f, 0x8e7f2d18, 0x7426281c, 0x3d1a553b, 0xe65ed252, 0xaf62af75,
+      0x9376a71f, 0xda4ada38, 0x010e5d51, 0x48322076, 0xb26b2572, 0xfb575855, 0x2013df3c, 0x692fa21b,
+      0xd14da3c5, 0x9871dee2, 0x4335598b, 0x0a0924ac, 0xf05021a8, 0xb96c5c8f, 0x6228dbe6, 0x2b14a6c1,
+      0x34019664, 0x7d3deb43, 0xa6796c2a, 0xef45110d, 0x151c1409, 0x5c20692e, 0x8764ee47, 0xce589360,
+      0x763a92be, 0x3f06ef99, 0xe44268f0, 0xad7e15d7, 0x572710d3, 0x1e1b6df4, 0xc55fea9d, 0x8c6397ba,
+      0xb0779fd0, 0xf94be2f7, 0x220f659e, 0x6b3318b9, 0x916a1dbd, 0xd856609a, 0x0312e7f3, 0x4a2e9ad4,
+      0xf24c9b0a, 0xbb70e62d, 0x60346144, 0x29081c63, 0xd3511967, 0x9a6d6440, 0x4129e329, 0x08159e0e,
+      0x3901f3fd, 0x703d8eda, 0xab7909b3, 0xe2457494, 0x181c7190, 0x51200cb7, 0x8a648bde, 0xc358f6f9,
+      0x7b3af727, 0x32068a00, 0xe9420d69, 0xa07e704e, 0x5a27754a, 0x131b086d, 0xc85f8f04, 0x8163f223,
+      0xbd77fa49, 0xf44b876e, 0x2f0f0007, 0x66337d20, 0x9c6a7824, 0xd5560503, 0x0e12826a, 0x472eff4d,
+      0xff4cfe93, 0xb67083b4, 0x6d3404dd, 0x240879fa, 0xde517cfe, 0x976d01d9, 0x4c2986b0, 0x0515fb97,
+      0x2e015d56, 0x673d2071, 0xbc79a718, 0xf545da3f, 0x0f1cdf3b, 0x4620a21c, 0x9d642575, 0xd4585852,
+      0x6c3a598c, 0x250624ab, 0xfe42a3c2, 0xb77edee5, 0x4d27dbe1, 0x041ba6c6, 0xdf5f21af, 0x96635c88,
+      0xaa7754e2, 0xe34b29c5, 0x380faeac, 0x7133d38b, 0x8b6ad68f, 0xc256aba8, 0x19122cc1, 0x502e51e6,
+      0xe84c5038, 0xa1702d1f, 0x7a34aa76, 0x3308d751, 0xc951d255, 0x806daf72, 0x5b29281b, 0x1215553c,
+      0x230138cf, 0x6a3d45e8, 0xb179c281, 0xf845bfa6, 0x021cbaa2, 0x4b20c785, 0x906440ec, 0xd9583dcb,
+      0x613a3c15, 0x28064132, 0xf342c65b, 0xba7ebb7c, 0x4027be78, 0x091bc35f, 0xd25f4436, 0x9b633911,
+      0xa777317b, 0xee4b4c5c, 0x350fcb35, 0x7c33b612, 0x866ab316, 0xcf56ce31, 0x14124958, 0x5d2e347f,
+      0xe54c35a1, 0xac704886, 0x7734cfef, 0x3e08b2c8, 0xc451b7cc, 0x8d6dcaeb, 0x56294d82, 0x1f1530a5
+    }
+  };
+
+  for (; size >= 8; size -= 8, p += 8) {
+    uint32_t lo = crc ^ ((uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24);
+    uint32_t hi = (uint32_t) p[4] | (uint32_t) p[5] << 8 | (uint32_t) p[6] << 16 | (uint32_t) p[7] << 24;
+    crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^ table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+          table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^ table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+  }
+  for (; size > 0; size--) {
+    crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+#else
+  // Like littlefs, use a small table that processes four bits at a time.
+  static const uint32_t table[16] = {
+    0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1, 0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+    0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9, 0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75
+  };
+  for (; size > 0; size--) {
+    crc = (crc >> 4) ^ table[(crc ^ *p) & 0xF];
+    crc = (crc >> 4) ^ table[(crc ^ (*p >> 4)) & 0xF];
+    p++;
+  }
+#endif
+
+  return ~crc;
+}
+
+// The object header that marks the remainder of the file as padding when
+// objects are placed without wrapping around the end of the file.
+#define LFSRING_PAD_MARKER ((lfs_size_t) 0xFFFFFFFF)
+
+// The maximum size of a variable-length object size.
+#define LFSRING_VARINT_MAX 5
+
+// The maximum size of an object header, which consists of the size of the
+// object and, optionally, its checksum.
+#define LFSRING_HEADER_MAX (LFSRING_VARINT_MAX + sizeof(uint32_t))
 
-  lfs_off_t write_offset = (get_pos_w(ring) + rel_off) % ring->file_size;
-  lfs_soff_t seeked = lfs_file_seek(ring->backend, &ring->file, write_offset, LFS_SEEK_SET);
+// Returns the number of bytes of the LEB128 encoding of the given value.
+static inline lfs_size_t get_varint_size(uint32_t value) {
+  lfs_size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+// Returns the number of bytes that precede an object of the given size within
+// the file. Variable-length headers encode the size plus one, such that the
+// padding marker is encoded as a single zero byte. The checksum of the object,
+// if any, follows the size.
+static inline lfs_size_t get_header_size(lfsring_t* ring, lfs_size_t obj_size) {
+  if (ring->mode != LFSRING_MODE_OBJECT) {
+    return 0;
+  }
+  lfs_size_t checksum_size = ring->checksums ? sizeof(uint32_t) : 0;
+  return (ring->varint_headers ? get_varint_size(obj_size + 1) : sizeof(lfs_size_t)) + checksum_size;
+}
+
+// Encodes the size part of the header of an object of the given size and
+// returns its length.
+static lfs_size_t encode_header(lfsring_t* ring, lfs_size_t obj_size, uint8_t* header) {
+  if (!ring->varint_headers) {
+    lfs_size_t le = lfs_tole32(obj_size);
+    memcpy(header, &le, sizeof(le));
+    return sizeof(le);
+  }
+
+  uint32_t value = obj_size + 1;
+  lfs_size_t size = 0;
+  while (value >= 0x80) {
+    header[size++] = (uint8_t) (value | 0x80);
+    value >>= 7;
+  }
+  header[size++] = (uint8_t) value;
+  return size;
+}
+
+// Moves the file position to the given offset, unless it is already there.
+// littlefs flushes its caches when seeking, so sequential accesses should not
+// seek at all.
+static int seek_to(lfsring_t* ring, lfs_file_t* file, lfs_off_t off) {
+  lfs_soff_t pos = lfs_file_tell(ring->backend, file);
+  if (pos >= 0 && (lfs_off_t) pos == off) {
+    return 0;
+  }
+
+  lfs_soff_t seeked = lfs_file_seek(ring->backend, file, off, LFS_SEEK_SET);
+  LFSRING_STAT_ADD(ring, seeks, 1);
   if (seeked < 0) {
     return seeked;
   }
-  LFS_ASSERT(write_offset == (lfs_off_t) seeked);
+  LFS_ASSERT(off == (lfs_off_t) seeked);
+  return 0;
+}
+
+static int do_write_impl(lfsring_t* ring, const void* data, lfs_size_t sz, lfs_off_t rel_off) {
+  LFS_ASSERT(sz <= ring->capacity);
+
+  // Empty elastic ring buffers do not have a capacity to map offsets to.
+  if (sz == 0) {
+    return 0;
+  }
+
+  lfs_off_t write_offset = get_file_offset(ring, get_pos_w(ring) + rel_off);
+  int err = seek_to(ring, &ring->file, write_offset);
+  if (err) {
+    return err;
+  }
 
-  lfs_size_t avail = ring->file_size - write_offset;
+  ring->unsynced_writes = true;
+
+  lfs_size_t avail = ring->capacity - write_offset;
   lfs_size_t fit = lfs_min(avail, sz);
 
   lfs_ssize_t written = lfs_file_write(ring->backend, &ring->file, data, fit);
@@ -64,7 +567,8 @@ static int do_write(lfsring_t* ring, const void* data, lfs_size_t sz, lfs_off_t
   LFS_ASSERT(fit == (lfs_size_t) written);
 
   if (fit < sz) {
-    int err = lfs_file_rewind(ring->backend, &ring->file);
+    err = lfs_file_rewind(ring->backend, &ring->file);
+    LFSRING_STAT_ADD(ring, rewinds, 1);
     if (err) {
       return err;
     }
@@ -76,23 +580,76 @@ static int do_write(lfsring_t* ring, const void* data, lfs_size_t sz, lfs_off_t
     LFS_ASSERT(sz - fit == (lfs_size_t) written);
   }
 
-  return lfs_file_sync(ring->backend, &ring->file);
+  return 0;
+}
+
+static int do_write(lfsring_t* ring, const void* data, lfs_size_t sz, lfs_off_t rel_off) {
+  LFSRING_EVENT_BEGIN(ring, "do_write", sz);
+  int err = do_write_impl(ring, data, sz, rel_off);
+  LFSRING_EVENT_END(ring, "do_write", err);
+  return err;
 }
 
-static int do_read(lfsring_t* ring, void* data, lfs_size_t sz, lfs_off_t rel_off) {
-  LFS_ASSERT(sz < ring->file_size);
+// Selects the file handle to read data up to the absolute position end from.
+// The reader handle is reopened when it does not see that data yet, or when it
+// has been closed because the writer committed changes. Data that has not been
+// committed can only be read through the writer handle.
+static int get_read_file(lfsring_t* ring, uint64_t end, lfs_file_t** file) {
+  *file = &ring->file;
+  if (ring->read_file_config.buffer == NULL) {
+    return 0;
+  }
 
-  lfs_off_t read_offset = (get_pos_r(ring) + rel_off) % ring->file_size;
-  lfs_soff_t seeked = lfs_file_seek(ring->backend, &ring->file, read_offset, LFS_SEEK_SET);
-  if (seeked < 0) {
-    return seeked;
+  if (!ring->read_file_open || end > ring->read_file_end) {
+    if (ring->unsynced_writes) {
+      return 0;
+    }
+
+    if (ring->read_file_open) {
+      ring->read_file_open = false;
+      int err = lfs_file_close(ring->backend, &ring->read_file);
+      if (err) {
+        return err;
+      }
+    }
+
+    int err = lfs_file_opencfg(ring->backend, &ring->read_file, ring->path, LFS_O_RDONLY,
+                               &ring->read_file_config);
+    if (err) {
+      return err;
+    }
+    ring->read_file_open = true;
+    ring->read_file_end = get_pos_w(ring);
+  }
+
+  *file = &ring->read_file;
+  return 0;
+}
+
+static int do_read_impl(lfsring_t* ring, void* data, lfs_size_t sz, lfs_off_t rel_off) {
+  LFS_ASSERT(sz <= ring->capacity);
+
+  // Empty elastic ring buffers do not have a capacity to map offsets to.
+  if (sz == 0) {
+    return 0;
+  }
+
+  lfs_file_t* file;
+  int err = get_read_file(ring, get_pos_r(ring) + rel_off + sz, &file);
+  if (err) {
+    return err;
+  }
+
+  lfs_off_t read_offset = get_file_offset(ring, get_pos_r(ring) + rel_off);
+  err = seek_to(ring, file, read_offset);
+  if (err) {
+    return err;
   }
-  LFS_ASSERT(read_offset == (lfs_off_t) seeked);
 
-  lfs_size_t avail = ring->file_size - read_offset;
+  lfs_size_t avail = ring->capacity - read_offset;
   lfs_size_t fit = lfs_min(avail, sz);
 
-  lfs_ssize_t n_read = lfs_file_read(ring->backend, &ring->file, data, fit);
+  lfs_ssize_t n_read = lfs_file_read(ring->backend, file, data, fit);
   if (n_read < 0) {
     return n_read;
   }
@@ -105,12 +662,13 @@ static int do_read(lfsring_t* ring, void* data, lfs_size_t sz, lfs_off_t rel_off
   LFS_ASSERT(fit == (lfs_size_t) n_read);
 
   if (fit < sz) {
-    int err = lfs_file_rewind(ring->backend, &ring->file);
+    err = lfs_file_rewind(ring->backend, file);
+    LFSRING_STAT_ADD(ring, rewinds, 1);
     if (err) {
       return err;
     }
 
-    n_read = lfs_file_read(ring->backend, &ring->file, ((uint8_t*) data) + fit, sz - fit);
+    n_read = lfs_file_read(ring->backend, file, ((uint8_t*) data) + fit, sz - fit);
     if (n_read < 0) {
       return n_read;
     }
@@ -126,26 +684,79 @@ static int do_read(lfsring_t* ring, void* data, lfs_size_t sz, lfs_off_t rel_off
   return 0;
 }
 
-static int advance_write_position(lfsring_t* ring, lfs_size_t distance) {
+static int do_read(lfsring_t* ring, void* data, lfs_size_t sz, lfs_off_t rel_off) {
+  LFSRING_EVENT_BEGIN(ring, "do_read", sz);
+  int err = do_read_impl(ring, data, sz, rel_off);
+  LFSRING_EVENT_END(ring, "do_read", err);
+  return err;
+}
+
+static void advance_write_position(lfsring_t* ring, lfs_size_t distance, lfs_size_t n_objects) {
+  LFSRING_EVENT_BEGIN(ring, "advance_write_position", distance);
   lfs_off_t old_write_dist = lfs_fromle32(ring->attr_buf.le.write_dist);
   LFS_ASSERT(old_write_dist + distance <= ring->file_size);
   ring->attr_buf.le.write_dist = lfs_tole32(old_write_dist + distance);
+  ring->attr_buf.le.count = lfs_tole32(lfs_fromle32(ring->attr_buf.le.count) + n_objects);
+  LFSRING_EVENT_END(ring, "advance_write_position", 0);
+}
 
-  // This is a hack. littlefs won't update attributes unless the file was
-  // modified, too.
-  // TODO: find a workaround that does not meddle with lfs internals
-  ring->file.flags |= LFS_F_DIRTY;
+// Returns the distance between the read position and the object that the i-th
+// entry of the index refers to.
+static lfs_off_t get_index_rel_off(lfsring_t* ring, lfs_size_t i) {
+  lfs_off_t off = ring->index[(ring->index_start + i) % ring->index_size];
+  lfs_off_t read_off = get_file_offset(ring, get_pos_r(ring));
+  return (off >= read_off) ? off - read_off : off + (ring->capacity - read_off);
+}
 
-  int err = lfs_file_sync(ring->backend, &ring->file);
-  if (err) {
-    // TODO: undo changes?
-    return err;
+// Adds the object at the given position, which must be the last object in the
+// ring buffer, to the index.
+static void index_push(lfsring_t* ring, uint64_t pos) {
+  if (!ring->index_valid) {
+    return;
   }
 
-  return 0;
+  lfs_size_t seq = ring->head_seq + ring->obj_count++;
+  if (seq % ring->index_interval != 0) {
+    return;
+  }
+
+  if (ring->index_len == ring->index_size) {
+    // Make room by discarding every other entry and doubling the interval.
+    lfs_size_t old_interval = ring->index_interval;
+    if (old_interval > (UINT32_MAX >> 1)) {
+      return;
+    }
+    ring->index_interval <<= 1;
+
+    lfs_size_t old_seq = ring->index_seq;
+    lfs_size_t n = 0;
+    for (lfs_size_t i = 0; i < ring->index_len; i++) {
+      lfs_size_t entry_seq = old_seq + i * old_interval;
+      if (entry_seq % ring->index_interval == 0) {
+        if (n == 0) {
+          ring->index_seq = entry_seq;
+        }
+        ring->index[(ring->index_start + n) % ring->index_size] =
+            ring->index[(ring->index_start + i) % ring->index_size];
+        n++;
+      }
+    }
+    ring->index_len = n;
+
+    if (seq % ring->index_interval != 0) {
+      return;
+    }
+  }
+
+  LFS_ASSERT(ring->index_len < ring->index_size);
+  if (ring->index_len == 0) {
+    ring->index_seq = seq;
+  }
+  ring->index[(ring->index_start + ring->index_len++) % ring->index_size] = get_file_offset(ring, pos);
 }
 
-static int advance_read_position(lfsring_t* ring, lfs_size_t distance) {
+static void advance_read_position(lfsring_t* ring, lfs_size_t distance, lfs_size_t n_objects) {
+  LFSRING_EVENT_BEGIN(ring, "advance_read_position", distance);
   lfs_off_t old_write_dist = lfs_fromle32(ring->attr_buf.le.write_dist);
   LFS_ASSERT(distance <= old_write_dist);
 
@@ -154,241 +765,2373 @@ static int advance_read_position(lfsring_t* ring, lfs_size_t distance) {
   ring->attr_buf.le.read_low = lfs_tole32(new_read_pos & UINT32_MAX);
   ring->attr_buf.le.write_dist = lfs_tole32(old_write_dist - distance);
 
+  lfs_size_t old_count = lfs_fromle32(ring->attr_buf.le.count);
+  LFS_ASSERT(n_objects <= old_count);
+  ring->attr_buf.le.count = lfs_tole32(old_count - n_objects);
+
+  ring->head_seq += n_objects;
+  if (ring->index_valid) {
+    LFS_ASSERT(n_objects <= ring->obj_count);
+    ring->obj_count -= n_objects;
+
+    // Remove index entries that refer to objects that have been removed.
+    while (ring->index_len != 0 && (int32_t) (ring->index_seq - ring->head_seq) < 0) {
+      ring->index_start = (ring->index_start + 1) % ring->index_size;
+      ring->index_len--;
+      ring->index_seq += ring->index_interval;
+    }
+  }
+  LFSRING_EVENT_END(ring, "advance_read_position", 0);
+}
+
+// Moves both positions of an empty ring buffer forward, which allows skipping
+// padding instead of storing it. The change is not committed.
+static void skip_empty(lfsring_t* ring, lfs_size_t distance) {
+  LFS_ASSERT(ring->attr_buf.le.write_dist == 0);
+  uint64_t new_read_pos = get_pos_r(ring) + distance;
+  ring->attr_buf.le.read_high = lfs_tole32(new_read_pos >> 32);
+  ring->attr_buf.le.read_low = lfs_tole32(new_read_pos & UINT32_MAX);
+}
+
+static int do_sync(lfsring_t* ring) {
   // This is a hack. littlefs won't update attributes unless the file was
   // modified, too.
   // TODO: find a workaround that does not meddle with lfs internals
   ring->file.flags |= LFS_F_DIRTY;
 
+  LFSRING_EVENT_BEGIN(ring, "do_sync", ring->unsynced_bytes);
   int err = lfs_file_sync(ring->backend, &ring->file);
+  LFSRING_EVENT_END(ring, "do_sync", err);
+  LFSRING_STAT_ADD(ring, syncs, 1);
   if (err) {
     // TODO: undo changes?
     return err;
   }
 
-  return 0;
-}
+  ring->unsynced_bytes = 0;
+  ring->unsynced_ops = 0;
 
-bool lfsring_is_empty(lfsring_t* ring) {
-  return ring->attr_buf.le.write_dist == 0;
+  // Committing rewritten data allows littlefs to reuse the blocks that the
+  // reader handle still refers to, so it must be reopened before its next use.
+  if (ring->unsynced_writes && ring->read_file_open) {
+    ring->read_file_open = false;
+    err = lfs_file_close(ring->backend, &ring->read_file);
+  }
+  ring->unsynced_writes = false;
+  return err;
 }
 
-int lfsring_append(lfsring_t* ring, const void* data, lfs_size_t data_size,
-                   enum lfsring_write_mode write_mode) {
-  LFSRING_TRACE("lfsring_append(%p, %p, %u, %d)", (void*) ring, data, data_size, write_mode);
+// Moves size bytes from the file offset src to the file offset dst. Both ranges
+// may overlap, but bytes are never overwritten before they have been read.
+static int move_range(lfsring_t* ring, lfs_off_t dst, lfs_off_t src, lfs_size_t size) {
+  uint8_t buffer[LFSRING_MOVE_BUFFER_SIZE];
+  for (lfs_size_t moved = 0; moved < size;) {
+    lfs_size_t n = lfs_min(sizeof(buffer), size - moved);
+    // Move the front first when moving data towards the beginning of the file,
+    // and the back first otherwise.
+    lfs_off_t off = (dst < src) ? moved : size - moved - n;
+
+    int err = seek_to(ring, &ring->file, src + off);
+    if (err) {
+      return err;
+    }
+    lfs_ssize_t n_read = lfs_file_read(ring->backend, &ring->file, buffer, n);
+    if (n_read < 0) {
+      return n_read;
+    }
+    if ((lfs_size_t) n_read < n) {
+      return LFS_ERR_CORRUPT;
+    }
 
-  if (write_mode != LFSRING_NO_OVERWRITE && write_mode != LFSRING_OVERWRITE) {
-    return LFS_ERR_INVAL;
+    err = seek_to(ring, &ring->file, dst + off);
+    if (err) {
+      return err;
+    }
+    lfs_ssize_t written = lfs_file_write(ring->backend, &ring->file, buffer, n);
+    if (written < 0) {
+      return written;
+    }
+    LFS_ASSERT(n == (lfs_size_t) written);
+
+    moved += n;
   }
 
-  lfs_size_t available_size = ring->file_size - lfs_fromle32(ring->attr_buf.le.write_dist);
+  return 0;
+}
 
-  if (ring->mode == LFSRING_MODE_OBJECT) {
-    lfs_size_t eff_avail = available_size;
-    if (write_mode == LFSRING_OVERWRITE) {
-      eff_avail = ring->file_size;
-    }
-    if (eff_avail < sizeof(lfs_size_t)) {
-      return LFS_ERR_NOSPC;
+// Changes the capacity, moving the part of the data that wraps around the end
+// of the file, if any, to the end of the resized region. The caller must ensure
+// that the data fits into the new capacity. The changes are not committed.
+static int relocate(lfsring_t* ring, lfs_size_t new_capacity) {
+  lfs_size_t used = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfs_off_t read_off = (used != 0) ? get_file_offset(ring, get_pos_r(ring)) : 0;
+  LFS_ASSERT(used <= new_capacity);
+
+  lfs_soff_t actual_size = lfs_file_size(ring->backend, &ring->file);
+  if (actual_size < 0) {
+    return actual_size;
+  }
+
+  lfs_off_t new_read_off = read_off;
+  if (read_off + used > ring->capacity) {
+    // The data consists of [read_off, capacity) followed by [0, wrapped). The
+    // latter fits before the former even after moving it to the end. Padding
+    // at the end of the file might not have been written, in which case it
+    // remains padding at the end of the resized region.
+    lfs_size_t tail = ring->capacity - read_off;
+    new_read_off = new_capacity - tail;
+    lfs_size_t written = ((lfs_size_t) actual_size > read_off) ? actual_size - read_off : 0;
+    int err = move_range(ring, new_read_off, read_off, lfs_min(tail, written));
+    if (err) {
+      return err;
     }
-    lfs_size_t max_obj_size = eff_avail - sizeof(lfs_size_t);
-    if (data_size > max_obj_size) {
-      return LFS_ERR_NOSPC;
+  } else if (read_off + used > new_capacity) {
+    new_read_off = 0;
+    int err = move_range(ring, 0, read_off, used);
+    if (err) {
+      return err;
     }
-  } else if (write_mode == LFSRING_OVERWRITE) {
-    if (data_size > ring->file_size) {
-      // If the buffer is too small to hold all of the data, only store the
-      // last part.
-      // TODO: consider moving both the read and the write position accordingly
-      data = ((const uint8_t*) data) + (data_size - ring->file_size);
-      data_size = ring->file_size;
+  }
+
+  actual_size = lfs_file_size(ring->backend, &ring->file);
+  if (actual_size < 0) {
+    return actual_size;
+  }
+  if ((lfs_size_t) actual_size > new_capacity) {
+    int err = lfs_file_truncate(ring->backend, &ring->file, new_capacity);
+    if (err) {
+      return err;
     }
-  } else if (data_size > available_size) {
-    return LFS_ERR_NOSPC;
   }
 
-  lfs_size_t write_size = data_size;
-  if (ring->mode == LFSRING_MODE_OBJECT) {
-    write_size += sizeof(lfs_size_t);
+  // The absolute read position must map to the new offset within the file.
+  lfs_off_t new_base = 0;
+  if (new_capacity != 0) {
+    lfs_off_t pos_off = get_pos_r(ring) % new_capacity;
+    new_base = (new_read_off + (new_capacity - pos_off)) % new_capacity;
+  }
+  ring->attr_buf.le.base = lfs_tole32(new_base);
+
+  ring->capacity = new_capacity;
+  ring->attr_buf.le.capacity = lfs_tole32(new_capacity);
+  ring->index_valid = false;
+  // The reader handle must not be used until the moved data has been committed.
+  ring->read_file_end = 0;
+  ring->unsynced_writes = true;
+  return 0;
+}
+
+// Grows the capacity of an elastic ring buffer such that write_size bytes fit
+// after the write position. The capacity is at least doubled to amortize the
+// cost of moving data, but never exceeds the file size.
+static int ensure_capacity(lfsring_t* ring, lfs_size_t write_size) {
+  lfs_size_t needed = lfs_fromle32(ring->attr_buf.le.write_dist) + write_size;
+  if (!ring->elastic || needed <= ring->capacity) {
+    return 0;
   }
 
-  // If we are going to overwrite existing data (i.e., data that would be
-  // returned by a subsequent read request), we pre-emptively move the read
-  // position forward.
-  if (write_mode == LFSRING_OVERWRITE) {
-    LFSRING_TRACE("write_size=%u available_size=%u", write_size, available_size);
-    if (write_size > available_size) {
-      lfs_size_t overlap_size = write_size - available_size;
-      if (ring->mode == LFSRING_MODE_OBJECT) {
-        lfs_size_t skippable = lfs_fromle32(ring->attr_buf.le.write_dist);
-        lfs_off_t dropped = 0;
-        while (dropped < overlap_size) {
-          LFS_ASSERT(dropped < skippable);
-
-          if (skippable - dropped < sizeof(lfs_size_t)) {
-            return LFS_ERR_CORRUPT;
-          }
-
-          lfs_size_t obj_size;
-          int err = do_read(ring, &obj_size, sizeof(obj_size), dropped);
-          if (err) {
-            return err;
-          }
-          obj_size = lfs_fromle32(obj_size);
-          dropped += sizeof(lfs_size_t);
-
-          LFS_ASSERT(dropped <= skippable);
-
-          if (skippable - dropped < obj_size) {
-            return LFS_ERR_CORRUPT;
-          }
-
-          dropped += obj_size;
-        }
-        overlap_size = dropped;
-      }
-      int err = advance_read_position(ring, overlap_size);
-      if (err) {
-        return err;
-      }
-    }
+  lfs_size_t new_capacity = ring->file_size;
+  if (ring->capacity <= ring->file_size / 2) {
+    new_capacity = lfs_min(lfs_max(needed, 2 * ring->capacity), ring->file_size);
   }
+  return relocate(ring, new_capacity);
+}
 
-  // In object mode, write the size of the object as a 32-bit integer before the
-  // actual data (i.e., the object).
-  if (ring->mode == LFSRING_MODE_OBJECT) {
-    lfs_size_t obj_size = lfs_tole32(data_size);
-    int err = do_write(ring, &obj_size, sizeof(lfs_size_t), 0);
+// Commits all data written since the last commit together with the current
+// read and write positions, unless the sync policy allows deferring the commit.
+// littlefs applies both atomically, so callers should only update the positions
+// once all data has been written successfully. The distance is the total number
+// of bytes by which the positions have been moved.
+static int commit(lfsring_t* ring, lfs_size_t distance) {
+  // Give the blocks of an elastic ring buffer back to littlefs once it has been
+  // drained.
+  if (ring->elastic && ring->attr_buf.le.write_dist == 0 && ring->capacity != 0) {
+    int err = relocate(ring, 0);
     if (err) {
       return err;
     }
   }
 
-  // We have ensured that there is enough space, so write the data.
-  int err = do_write(ring, data, data_size, (ring->mode == LFSRING_MODE_OBJECT) ? sizeof(lfs_size_t) : 0);
-  if (err) {
-    return err;
+  ring->unsynced_bytes += lfs_min(distance, UINT32_MAX - ring->unsynced_bytes);
+  ring->unsynced_ops++;
+
+  bool sync;
+  switch (ring->sync_policy) {
+  case LFSRING_SYNC_BYTES:
+    sync = ring->unsynced_bytes >= ring->sync_threshold;
+    break;
+  case LFSRING_SYNC_OPS:
+    sync = ring->unsynced_ops >= ring->sync_threshold;
+    break;
+  case LFSRING_SYNC_MANUAL:
+    sync = false;
+    break;
+  default:
+    sync = true;
+    break;
   }
 
-  err = advance_write_position(ring, write_size);
-  if (err) {
-    return err;
+  if (!sync) {
+    // Make sure that littlefs writes the attribute when the file is synced or
+    // closed eventually, even if no data has been written.
+    ring->file.flags |= LFS_F_DIRTY;
+    return 0;
   }
 
-  return 0;
+  return do_sync(ring);
 }
 
-lfs_ssize_t lfsring_peek(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
-  LFSRING_TRACE("lfsring_peek(%p, %p, %u)", (void*) ring, buffer, buffer_size);
-
-  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+// Reads and decodes the object header at the given distance from the read
+// position, which must not extend beyond avail bytes.
+static int read_header(lfsring_t* ring, lfs_off_t rel_off, lfs_size_t avail, lfs_size_t* obj_size) {
+  LFSRING_STAT_ADD(ring, header_reads, 1);
+  if (!ring->varint_headers) {
+    int err = do_read(ring, obj_size, sizeof(*obj_size), rel_off);
+    *obj_size = lfs_fromle32(*obj_size);
+    return err;
+  }
 
-  if (ring->mode == LFSRING_MODE_OBJECT) {
-    if (avail == 0) {
-      // Unlike in stream mode, we cannot return 0 here because objects can be
-      // empty (i.e., have a size of 0 bytes) and the caller must be able to
-      // distinguish between "no object" and "empty object".
-      return LFS_ERR_NOENT;
-    } else if (avail < sizeof(lfs_size_t)) {
-      // Objects always begin with four bytes that encode the size of the
-      // object. If there are fewer bytes in the buffer, the file is corrupt.
-      return LFS_ERR_CORRUPT;
-    } else {
-      // Read the size of the object first.
-      lfs_size_t obj_size;
-      int err = do_read(ring, &obj_size, sizeof(obj_size), 0);
+  // Read the first byte on its own because a padding marker might be the last
+  // byte that was written. Avoid reading across the end of the file unless the
+  // header continues there.
+  uint8_t header[LFSRING_VARINT_MAX];
+  lfs_size_t max_size = lfs_min(avail, sizeof(header));
+  lfs_size_t tail = ring->capacity - get_file_offset(ring, get_pos_r(ring) + rel_off);
+  lfs_size_t n_read = 0;
+  uint32_t value = 0;
+  for (lfs_size_t i = 0; i < max_size; i++) {
+    if (i == n_read) {
+      lfs_size_t n = (i == 0) ? 1 : (i < tail) ? lfs_min(max_size, tail) - i : max_size - i;
+      int err = do_read(ring, header + i, n, rel_off + i);
       if (err) {
         return err;
       }
-      obj_size = lfs_fromle32(obj_size);
-      // If there are fewer bytes available than the size of the object, the
-      // file is corrupt.
-      if (avail - sizeof(lfs_size_t) < obj_size) {
+      n_read += n;
+    }
+
+    // The fifth byte only contributes four bits, and the encoding must not
+    // contain redundant bytes.
+    if (i == LFSRING_VARINT_MAX - 1 && header[i] > 0x0F) {
+      return LFS_ERR_CORRUPT;
+    }
+    value |= (uint32_t) (header[i] & 0x7F) << (7 * i);
+    if ((header[i] & 0x80) == 0) {
+      if (get_varint_size(value) != i + 1) {
         return LFS_ERR_CORRUPT;
       }
-      // If the buffer provided by the user is too small to retrieve the entire
-      // object, fail to ensure that objects are only retrieved as a whole.
-      if (obj_size > buffer_size) {
-        return LFS_ERR_NOMEM;
-      }
-      buffer_size = obj_size;
+      *obj_size = value - 1;
+      return 0;
+    }
+  }
+
+  return LFS_ERR_CORRUPT;
+}
+
+// Reads the size of the object at the given distance from the read position,
+// where avail is the number of bytes between the object and the write position.
+// If the object is preceded by padding, rel_off is moved past the padding.
+static int read_object_size(lfsring_t* ring, lfs_off_t* rel_off, lfs_size_t avail, lfs_size_t* obj_size) {
+  // In LFSRING_MODE_FIXED, all objects have the same size and no header.
+  if (ring->mode == LFSRING_MODE_FIXED) {
+    if (avail < ring->record_size) {
+      return LFS_ERR_CORRUPT;
+    }
+    *obj_size = ring->record_size;
+    return 0;
+  }
+
+  // Objects always begin with a header that encodes the size of the object. If
+  // there are fewer bytes in the buffer, the file is corrupt.
+  lfs_size_t min_header_size = get_header_size(ring, 0);
+  if (avail < min_header_size) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  // Padding fills the remainder of the file. If there are fewer bytes left than
+  // the size of a header, the padding is implicit.
+  lfs_size_t tail = ring->capacity - get_file_offset(ring, get_pos_r(ring) + *rel_off);
+  bool padded = ring->wrap_free && tail < min_header_size;
+  for (int i = 0; i < 2; i++) {
+    if (padded) {
+      if (tail > avail || avail - tail < min_header_size) {
+        return LFS_ERR_CORRUPT;
+      }
+      *rel_off += tail;
+      avail -= tail;
+    }
+
+    int err = read_header(ring, *rel_off, avail, obj_size);
+    if (err) {
+      return err;
+    }
+
+    if (padded || !ring->wrap_free || *obj_size != LFSRING_PAD_MARKER) {
+      break;
+    }
+    padded = true;
+  }
+
+  // If there are fewer bytes available than the size of the object, the file is
+  // corrupt.
+  if (*obj_size == LFSRING_PAD_MARKER || avail - get_header_size(ring, *obj_size) < *obj_size) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  return 0;
+}
+
+// Reads the data of the object whose header begins at the given distance from
+// the read position and, unless disabled, verifies its checksum.
+static int read_object_data(lfsring_t* ring, void* buffer, lfs_size_t obj_size, lfs_off_t rel_off) {
+  lfs_size_t header_size = get_header_size(ring, obj_size);
+  uint32_t checksum = 0;
+  bool verify = ring->checksums && ring->verify;
+  if (verify) {
+    // The checksum is the last part of the header.
+    int err = do_read(ring, &checksum, sizeof(checksum), rel_off + header_size - sizeof(checksum));
+    if (err) {
+      return err;
     }
-  } else {
-    // Do not read more bytes than available.
-    buffer_size = lfs_min(avail, buffer_size);
   }
 
-  int err = do_read(ring, buffer, buffer_size, (ring->mode == LFSRING_MODE_OBJECT) ? sizeof(lfs_size_t) : 0);
+  int err = do_read(ring, buffer, obj_size, rel_off + header_size);
   if (err) {
     return err;
   }
 
-  return buffer_size;
+  if (verify && crc32c(0, buffer, obj_size) != lfs_fromle32(checksum)) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  return 0;
 }
 
-lfs_ssize_t lfsring_take(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
-  LFSRING_TRACE("lfsring_take(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+// Moves rel_off, which must be the distance between the read position and an
+// object, forward by n objects.
+static int skip_objects(lfsring_t* ring, lfs_off_t* rel_off, lfs_size_t n) {
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
 
-  lfs_ssize_t ret = lfsring_peek(ring, buffer, buffer_size);
-  if (ret < 0) {
-    return ret;
+  if (ring->mode == LFSRING_MODE_FIXED) {
+    if (n > (avail - *rel_off) / ring->record_size) {
+      return LFS_ERR_INVAL;
+    }
+    *rel_off += n * ring->record_size;
+    return 0;
   }
 
-  LFS_ASSERT((lfs_size_t) ret <= buffer_size);
+  while (n-- > 0) {
+    if (*rel_off == avail) {
+      return LFS_ERR_INVAL;
+    }
+
+    LFS_ASSERT(*rel_off < avail);
+
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, rel_off, avail - *rel_off, &obj_size);
+    if (err) {
+      return err;
+    }
+
+    *rel_off += get_header_size(ring, obj_size) + obj_size;
+  }
+
+  return 0;
+}
+
+// Builds the index, unless it is already valid, by reading the header of each
+// object in the ring buffer. Sets has_index to false if the ring buffer does
+// not have an index.
+static int load_index(lfsring_t* ring, bool* has_index) {
+  *has_index = ring->index != NULL;
+  if (!*has_index || ring->index_valid) {
+    return 0;
+  }
+
+  ring->index_start = 0;
+  ring->index_len = 0;
+  ring->obj_count = 0;
+  ring->index_valid = true;
+
+  uint64_t pos_r = get_pos_r(ring);
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfs_off_t rel_off = 0;
+  while (rel_off < avail) {
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, &rel_off, avail - rel_off, &obj_size);
+    if (err) {
+      ring->index_valid = false;
+      return err;
+    }
+
+    index_push(ring, pos_r + rel_off);
+    rel_off += get_header_size(ring, obj_size) + obj_size;
+  }
 
-  int err = advance_read_position(ring, (lfs_size_t) ret + ((ring->mode == LFSRING_MODE_OBJECT) ? sizeof(lfs_size_t) : 0));
+  return 0;
+}
+
+// Determines the distance between the read position and the n-th object.
+static int find_object(lfsring_t* ring, lfs_size_t n, lfs_off_t* rel_off) {
+  bool has_index;
+  int err = load_index(ring, &has_index);
   if (err) {
     return err;
   }
 
-  return ret;
+  *rel_off = 0;
+  if (!has_index) {
+    return skip_objects(ring, rel_off, n);
+  }
+
+  if (n > ring->obj_count) {
+    return LFS_ERR_INVAL;
+  }
+
+  // Start at the closest indexed object that is not after the n-th object.
+  lfs_size_t seq = ring->head_seq;
+  lfs_size_t target_seq = ring->head_seq + n;
+  if (ring->index_len != 0 && (int32_t) (target_seq - ring->index_seq) >= 0) {
+    lfs_size_t i = lfs_min((target_seq - ring->index_seq) / ring->index_interval, ring->index_len - 1);
+    seq = ring->index_seq + i * ring->index_interval;
+    *rel_off = get_index_rel_off(ring, i);
+  }
+
+  return skip_objects(ring, rel_off, target_seq - seq);
 }
 
-int lfsring_drop(lfsring_t* ring, lfs_off_t n) {
-  LFSRING_TRACE("lfsring_drop(%p, %u)", (void*) ring, n);
+// Determines how far the read position needs to be moved forward in order to
+// free at least min_size bytes. In object mode, this may be more than min_size
+// because objects are only ever discarded as a whole.
+static int get_overlap_size_impl(lfsring_t* ring, lfs_size_t min_size, lfs_size_t* overlap_size,
+                                 lfs_size_t* n_objects) {
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    *overlap_size = min_size;
+    *n_objects = 0;
+    return 0;
+  } else if (ring->mode == LFSRING_MODE_FIXED) {
+    *n_objects = min_size / ring->record_size + (min_size % ring->record_size != 0);
+    *overlap_size = *n_objects * ring->record_size;
+    return 0;
+  }
+
+  bool has_index;
+  int err = load_index(ring, &has_index);
+  if (err) {
+    return err;
+  }
+
+  lfs_size_t skippable = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfs_off_t dropped = 0;
+  lfs_size_t n = 0;
+
+  // Find the last indexed object that begins before min_size using binary
+  // search, and only read object headers from there on.
+  if (has_index && ring->index_len != 0 && get_index_rel_off(ring, 0) <= min_size) {
+    lfs_size_t lo = 0, hi = ring->index_len - 1;
+    while (lo < hi) {
+      lfs_size_t mid = lo + (hi - lo + 1) / 2;
+      if (get_index_rel_off(ring, mid) <= min_size) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    dropped = get_index_rel_off(ring, lo);
+    n = ring->index_seq + lo * ring->index_interval - ring->head_seq;
+  }
+
+  while (dropped < min_size) {
+    LFS_ASSERT(dropped < skippable);
+
+    lfs_size_t obj_size;
+    err = read_object_size(ring, &dropped, skippable - dropped, &obj_size);
+    if (err) {
+      return err;
+    }
 
+    dropped += get_header_size(ring, obj_size) + obj_size;
+    n++;
+  }
+
+  *overlap_size = dropped;
+  *n_objects = n;
+  return 0;
+}
+
+static int get_overlap_size(lfsring_t* ring, lfs_size_t min_size, lfs_size_t* overlap_size,
+                            lfs_size_t* n_objects) {
+  LFSRING_EVENT_BEGIN(ring, "get_overlap_size", min_size);
+  int err = get_overlap_size_impl(ring, min_size, overlap_size, n_objects);
+  LFSRING_EVENT_END(ring, "get_overlap_size", err ? err : (lfs_ssize_t) *overlap_size);
+  return err;
+}
+
+// Determines how many bytes need to be skipped at the given distance from the
+// write position such that an object that occupies write_size bytes does not
+// wrap around the end of the file.
+static lfs_size_t get_padding(lfsring_t* ring, lfs_off_t rel_off, lfs_size_t write_size) {
+  if (!ring->wrap_free) {
+    return 0;
+  }
+
+  lfs_size_t tail = ring->capacity - get_file_offset(ring, get_pos_w(ring) + rel_off);
+  return (write_size > tail) ? tail : 0;
+}
+
+// In object mode, writes the header of the object, followed by the actual data
+// (i.e., the object), at the given distance from the write position. If padding
+// is not zero, the object is preceded by padding bytes, which begin with a
+// marker unless they are too few to hold one.
+static int write_object(lfsring_t* ring, const void* data, lfs_size_t data_size, lfs_off_t rel_off,
+                        lfs_size_t padding) {
+  uint8_t header[LFSRING_HEADER_MAX];
+  if (ring->mode == LFSRING_MODE_OBJECT && padding > 0 &&
+      padding >= get_header_size(ring, LFSRING_PAD_MARKER)) {
+    lfs_size_t header_size = encode_header(ring, LFSRING_PAD_MARKER, header);
+    int err = do_write(ring, header, header_size, rel_off);
+    if (err) {
+      return err;
+    }
+  }
+  rel_off += padding;
+
+  if (ring->mode == LFSRING_MODE_OBJECT) {
+    lfs_size_t header_size = encode_header(ring, data_size, header);
+    if (ring->checksums) {
+      uint32_t checksum = lfs_tole32(crc32c(0, data, data_size));
+      memcpy(header + header_size, &checksum, sizeof(checksum));
+      header_size += sizeof(checksum);
+    }
+    int err = do_write(ring, header, header_size, rel_off);
+    if (err) {
+      return err;
+    }
+  }
+
+  return do_write(ring, data, data_size, rel_off + get_header_size(ring, data_size));
+}
+
+// Counts the objects in the ring buffer by reading the header of each object.
+static int count_objects(lfsring_t* ring, lfs_size_t* count) {
   lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfs_off_t rel_off = 0;
+  for (*count = 0; rel_off < avail; ++*count) {
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, &rel_off, avail - rel_off, &obj_size);
+    if (err) {
+      return err;
+    }
+    rel_off += get_header_size(ring, obj_size) + obj_size;
+  }
+  return 0;
+}
 
-  if (ring->mode == LFSRING_MODE_STREAM) {
-    if (n > avail) {
+// Flags that are stored in the metadata attribute.
+#define LFSRING_FLAG_ELASTIC ((uint8_t) 0x01)
+#define LFSRING_FLAG_WRAP_FREE ((uint8_t) 0x02)
+#define LFSRING_FLAG_VARINT_HEADERS ((uint8_t) 0x04)
+#define LFSRING_FLAG_CHECKSUMS ((uint8_t) 0x08)
+#define LFSRING_KNOWN_FLAGS (LFSRING_FLAG_ELASTIC | LFSRING_FLAG_WRAP_FREE | LFSRING_FLAG_VARINT_HEADERS | \
+                             LFSRING_FLAG_CHECKSUMS)
+
+// Validates the header that is stored in the metadata attribute, or creates it
+// if the attribute was created by an older version or does not exist yet. If
+// the configured file size is zero, the stored geometry and mode are used.
+static int load_header(lfsring_t* ring, const lfsring_config_t* config) {
+  if (ring->attr_buf.le.version == 0) {
+    if (config->file_size == 0) {
       return LFS_ERR_INVAL;
     }
 
-    return advance_read_position(ring, n);
+    ring->mode = config->mode;
+    ring->file_size = config->file_size;
+    ring->record_size = config->record_size;
+    ring->elastic = config->elastic;
+    ring->wrap_free = config->wrap_free;
+    ring->varint_headers = config->varint_headers;
+    ring->checksums = config->checksums;
+
+    // A new elastic ring buffer does not occupy any space yet.
+    ring->capacity = ring->file_size;
+    if (ring->elastic && ring->attr_buf.le.write_dist == 0) {
+      ring->capacity = 0;
+    }
+
+    ring->attr_buf.le.version = LFSRING_FORMAT_VERSION;
+    ring->attr_buf.le.mode = (uint8_t) ring->mode;
+    ring->attr_buf.le.flags = (ring->elastic ? LFSRING_FLAG_ELASTIC : 0) |
+                              (ring->wrap_free ? LFSRING_FLAG_WRAP_FREE : 0) |
+                              (ring->varint_headers ? LFSRING_FLAG_VARINT_HEADERS : 0) |
+                              (ring->checksums ? LFSRING_FLAG_CHECKSUMS : 0);
+    ring->attr_buf.le.file_size = lfs_tole32(ring->file_size);
+    ring->attr_buf.le.record_size = lfs_tole32(ring->record_size);
+    ring->attr_buf.le.capacity = lfs_tole32(ring->capacity);
   } else {
-    lfs_off_t dropped = 0;
-    while (n-- > 0) {
-      if (avail == dropped) {
-        return LFS_ERR_INVAL;
-      }
+    if (ring->attr_buf.le.version != LFSRING_FORMAT_VERSION ||
+        (ring->attr_buf.le.flags & ~LFSRING_KNOWN_FLAGS) != 0) {
+      return LFS_ERR_INVAL;
+    }
 
-      LFS_ASSERT(dropped < avail);
+    ring->mode = (enum lfsring_mode) ring->attr_buf.le.mode;
+    ring->file_size = lfs_fromle32(ring->attr_buf.le.file_size);
+    ring->record_size = lfs_fromle32(ring->attr_buf.le.record_size);
+    ring->elastic = (ring->attr_buf.le.flags & LFSRING_FLAG_ELASTIC) != 0;
+    ring->wrap_free = (ring->attr_buf.le.flags & LFSRING_FLAG_WRAP_FREE) != 0;
+    ring->varint_headers = (ring->attr_buf.le.flags & LFSRING_FLAG_VARINT_HEADERS) != 0;
+    ring->checksums = (ring->attr_buf.le.flags & LFSRING_FLAG_CHECKSUMS) != 0;
+    ring->capacity = lfs_fromle32(ring->attr_buf.le.capacity);
+
+    if (config->file_size != 0 &&
+        (config->file_size != ring->file_size || config->mode != ring->mode ||
+         config->elastic != ring->elastic || config->wrap_free != ring->wrap_free ||
+         config->varint_headers != ring->varint_headers || config->checksums != ring->checksums ||
+         (ring->mode == LFSRING_MODE_FIXED && config->record_size != ring->record_size))) {
+      return LFS_ERR_INVAL;
+    }
+  }
 
-      if (avail - dropped < sizeof(lfs_size_t)) {
-        return LFS_ERR_CORRUPT;
-      }
+  if (ring->mode != LFSRING_MODE_STREAM && ring->mode != LFSRING_MODE_OBJECT &&
+      ring->mode != LFSRING_MODE_FIXED) {
+    return LFS_ERR_CORRUPT;
+  }
 
-      lfs_size_t obj_size;
-      int err = do_read(ring, &obj_size, sizeof(obj_size), dropped);
-      if (err) {
-        return err;
-      }
-      obj_size = lfs_fromle32(obj_size);
-      dropped += sizeof(lfs_size_t);
+  if ((ring->mode == LFSRING_MODE_FIXED && ring->record_size == 0) ||
+      (ring->wrap_free && (ring->mode != LFSRING_MODE_OBJECT || ring->elastic)) ||
+      ((ring->varint_headers || ring->checksums) && ring->mode != LFSRING_MODE_OBJECT) ||
+      ring->capacity > ring->file_size || (!ring->elastic && ring->capacity != ring->file_size) ||
+      lfs_fromle32(ring->attr_buf.le.write_dist) > ring->capacity ||
+      lfs_fromle32(ring->attr_buf.le.base) >= lfs_max(ring->capacity, 1)) {
+    return LFS_ERR_CORRUPT;
+  }
 
-      LFS_ASSERT(dropped <= avail);
+  return 0;
+}
 
-      if (avail - dropped < obj_size) {
-        return LFS_ERR_CORRUPT;
+static int open_impl(lfsring_t* ring, lfs_t* lfs, const char* path,
+                     const lfsring_config_t* config) {
+#ifdef LFSRING_YES_STATS
+  memset(&ring->stats, 0, sizeof(ring->stats));
+#endif
+#ifdef LFSRING_YES_HISTOGRAMS
+  memset(&ring->histograms, 0, sizeof(ring->histograms));
+#endif
+
+  if (config->file_size != 0 &&
+      ((config->mode == LFSRING_MODE_FIXED && config->record_size == 0) ||
+       (config->wrap_free && (config->mode != LFSRING_MODE_OBJECT || config->elastic)) ||
+       ((config->varint_headers || config->checksums) && config->mode != LFSRING_MODE_OBJECT))) {
+    return LFS_ERR_INVAL;
+  }
+
+  ring->attr.type = config->attr_metadata;
+  ring->attr.buffer = ring->attr_buf.bytes;
+  ring->attr.size = sizeof(ring->attr_buf.bytes);
+
+  LFS_ASSERT(sizeof(ring->attr_buf.bytes) == sizeof(ring->attr_buf));
+
+  // If the attribute does not exist, littlefs will silently create it. Thus,
+  // we need to initialize the buffer.
+  memset(ring->attr_buf.bytes, 0, sizeof(ring->attr_buf.bytes));
+
+  memset(&ring->file_config, 0, sizeof(ring->file_config));
+  ring->file_config.buffer = config->file_buffer;
+  ring->file_config.attrs = &ring->attr;
+  ring->file_config.attr_count = 1;
+
+  memset(&ring->read_file_config, 0, sizeof(ring->read_file_config));
+  ring->read_file_config.buffer = config->read_buffer;
+  ring->path = path;
+  ring->read_file_open = false;
+  ring->unsynced_writes = false;
+
+  // Without a file size, only existing ring buffers can be opened. Read-only
+  // ring buffers must not modify the file at all.
+  int flags = LFS_O_RDONLY;
+  if (!config->read_only) {
+    flags = (config->file_size != 0) ? (LFS_O_CREAT | LFS_O_RDWR) : LFS_O_RDWR;
+  }
+  int lfs_err = lfs_file_opencfg(lfs, &ring->file, path, flags, &ring->file_config);
+  if (lfs_err != 0) {
+    return lfs_err;
+  }
+
+  ring->backend = lfs;
+  ring->verify = !config->no_verify;
+  ring->read_only = config->read_only;
+  ring->sync_policy = config->sync_policy;
+  ring->sync_threshold = config->sync_threshold;
+  ring->unsynced_bytes = 0;
+  ring->unsynced_ops = 0;
+  ring->head_seq = 0;
+
+  bool has_header = ring->attr_buf.le.version != 0;
+  int err = load_header(ring, config);
+
+  // Ring buffers created by older versions do not necessarily store the number
+  // of objects, which thus needs to be determined once.
+  if (err == 0 && !has_header && ring->attr_buf.le.count == 0 &&
+      ring->attr_buf.le.write_dist != 0 && ring->mode != LFSRING_MODE_STREAM) {
+    lfs_size_t count;
+    err = count_objects(ring, &count);
+    ring->attr_buf.le.count = lfs_tole32(count);
+  }
+
+  if (err) {
+    lfs_file_close(lfs, &ring->file);
+    return err;
+  }
+
+  // The index is built lazily when it is needed for the first time.
+  ring->index = NULL;
+  ring->index_valid = false;
+  ring->group = NULL;
+  if (ring->mode == LFSRING_MODE_OBJECT && config->index_buffer != NULL &&
+      config->index_size >= 2) {
+    ring->index = config->index_buffer;
+    ring->index_size = config->index_size;
+    ring->index_interval = 1;
+    while (ring->index_interval < config->index_interval && ring->index_interval < (UINT32_MAX >> 1) + 1) {
+      ring->index_interval <<= 1;
+    }
+  }
+
+  return 0;
+}
+
+int lfsring_open(lfsring_t* ring, lfs_t* lfs, const char* path,
+                 const lfsring_config_t* config) {
+  LFSRING_TRACE("lfsring_open(%p, %p, \"%s\", %p {  })", (void*) ring, (void*) lfs, path, (void*) config);
+#if defined(LFSRING_YES_HISTOGRAMS) || defined(LFSRING_YES_EVENTS)
+  ring->clock = config->clock;
+  ring->clock_ctx = config->clock_ctx;
+#endif
+#ifdef LFSRING_YES_EVENTS
+  ring->event_cb = config->event_cb;
+  ring->event_ctx = config->event_ctx;
+#endif
+  LFSRING_EVENT_BEGIN(ring, "lfsring_open", config->file_size);
+#ifdef LFSRING_YES_HISTOGRAMS
+  uint32_t start = (config->clock != NULL) ? config->clock(config->clock_ctx) : 0;
+#endif
+  int err = count_error(ring, open_impl(ring, lfs, path, config));
+#ifdef LFSRING_YES_HISTOGRAMS
+  if (err == 0) {
+    record_latency(ring, LFSRING_OP_OPEN, start);
+  }
+#endif
+  LFSRING_EVENT_END(ring, "lfsring_open", err);
+  return err;
+}
+
+bool lfsring_is_empty(lfsring_t* ring) {
+  return ring->attr_buf.le.write_dist == 0;
+}
+
+lfs_ssize_t lfsring_count(lfsring_t* ring) {
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    return LFS_ERR_INVAL;
+  }
+  return lfs_fromle32(ring->attr_buf.le.count);
+}
+
+lfs_size_t lfsring_used_bytes(lfsring_t* ring) {
+  return lfs_fromle32(ring->attr_buf.le.write_dist);
+}
+
+lfs_size_t lfsring_free_bytes(lfsring_t* ring) {
+  lfs_size_t free_bytes = ring->file_size - lfs_fromle32(ring->attr_buf.le.write_dist);
+  if (ring->group != NULL) {
+    lfs_size_t used = lfsring_group_used_bytes(ring->group);
+    free_bytes = lfs_min(free_bytes, (used < ring->group->budget) ? ring->group->budget - used : 0);
+  }
+  return free_bytes;
+}
+
+// Discards the oldest data of ring buffers in the same group that have a lower
+// weight, in order of increasing weight, until the group has room for size
+// bytes or no such data remains. Then determines how many bytes the ring buffer
+// may occupy within the budget of the group, which is at most its file size.
+static int group_make_room(lfsring_t* ring, lfs_size_t size, lfs_size_t* size_limit) {
+  *size_limit = ring->file_size;
+  if (ring->group == NULL) {
+    return 0;
+  }
+
+  lfs_size_t used = lfsring_group_used_bytes(ring->group);
+  lfs_size_t room = (used < ring->group->budget) ? ring->group->budget - used : 0;
+
+  // Visit other ring buffers ordered by weight and, for equal weights, by their
+  // position within the group.
+  uint32_t prev_weight = 0;
+  lfs_size_t prev_i = 0;
+  bool first = true;
+  while (room < size) {
+    lfsring_t* victim = NULL;
+    lfs_size_t victim_i = 0, i = 0;
+    for (lfsring_t* other = ring->group->rings; other != NULL; other = other->group_next, i++) {
+      if (other == ring || other->group_weight >= ring->group_weight) {
+        continue;
       }
+      bool after_prev = first || other->group_weight > prev_weight ||
+                        (other->group_weight == prev_weight && i > prev_i);
+      bool before_victim = victim == NULL || other->group_weight < victim->group_weight;
+      if (after_prev && before_victim) {
+        victim = other;
+        victim_i = i;
+      }
+    }
+    if (victim == NULL) {
+      break;
+    }
+    first = false;
+    prev_weight = victim->group_weight;
+    prev_i = victim_i;
+
+    lfs_size_t victim_used = lfs_fromle32(victim->attr_buf.le.write_dist);
+    if (victim->read_only || victim_used <= victim->group_min) {
+      continue;
+    }
+    lfs_size_t evictable = victim_used - victim->group_min;
 
-      dropped += obj_size;
+    lfs_size_t overlap_size, n_overwritten;
+    int err = get_overlap_size(victim, lfs_min(size - room, evictable), &overlap_size, &n_overwritten);
+    if (err) {
+      return err;
+    }
+    // Objects are only discarded as a whole, which might not be possible
+    // without going below the minimum size.
+    if (overlap_size > evictable) {
+      continue;
     }
 
-    return advance_read_position(ring, dropped);
+    LFSRING_STAT_ADD(victim, bytes_overwritten, overlap_size);
+    LFSRING_STAT_ADD(victim, objects_overwritten, n_overwritten);
+    advance_read_position(victim, overlap_size, n_overwritten);
+    err = commit(victim, overlap_size);
+    if (err) {
+      return err;
+    }
+    room += overlap_size;
   }
+
+  lfs_size_t own_used = lfs_fromle32(ring->attr_buf.le.write_dist);
+  *size_limit = own_used + lfs_min(room, ring->file_size - own_used);
+  return 0;
 }
 
-int lfsring_close(lfsring_t* ring) {
-  LFSRING_TRACE("lfsring_close(%p)", (void*) ring);
-  return lfs_file_close(ring->backend, &ring->file);
+static int append_impl(lfsring_t* ring, const void* data, lfs_size_t data_size,
+                       enum lfsring_write_mode write_mode) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (write_mode != LFSRING_NO_OVERWRITE && write_mode != LFSRING_OVERWRITE) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (ring->mode == LFSRING_MODE_FIXED && data_size != ring->record_size) {
+    return LFS_ERR_INVAL;
+  }
+
+  // An empty ring buffer does not need padding, the object can simply be
+  // written at the beginning of the file.
+  lfs_size_t header_size = get_header_size(ring, data_size);
+  lfs_size_t padding = get_padding(ring, 0, header_size + data_size);
+  if (padding != 0 && ring->attr_buf.le.write_dist == 0) {
+    skip_empty(ring, padding);
+    padding = 0;
+  }
+
+  // If the object does not fit after the padding, it overwrites all existing
+  // data and the padding itself, so the padding can be skipped after removing
+  // the existing data. Otherwise, padding counts towards the header because it
+  // is only needed for this object.
+  bool skip_padding = false;
+  if (write_mode == LFSRING_OVERWRITE && padding != 0) {
+    lfs_size_t write_offset = ring->capacity - padding;
+    skip_padding = header_size > write_offset || data_size > write_offset - header_size;
+  }
+  if (!skip_padding) {
+    header_size += padding;
+  }
+
+  // Within a group, the ring buffer might not be allowed to use its entire file.
+  lfs_size_t size_limit;
+  lfs_size_t wanted = (data_size < ring->file_size - lfs_min(header_size, ring->file_size))
+                      ? header_size + data_size : ring->file_size;
+  int err = group_make_room(ring, (write_mode == LFSRING_OVERWRITE) ? wanted : 0, &size_limit);
+  if (err) {
+    return err;
+  }
+
+  lfs_size_t available_size = size_limit - lfs_fromle32(ring->attr_buf.le.write_dist);
+
+  if (ring->mode != LFSRING_MODE_STREAM) {
+    lfs_size_t eff_avail = available_size;
+    if (write_mode == LFSRING_OVERWRITE) {
+      eff_avail = size_limit;
+    }
+    if (eff_avail < header_size) {
+      return LFS_ERR_NOSPC;
+    }
+    lfs_size_t max_obj_size = eff_avail - header_size;
+    if (data_size > max_obj_size) {
+      return LFS_ERR_NOSPC;
+    }
+  } else if (write_mode == LFSRING_OVERWRITE) {
+    if (data_size > size_limit) {
+      // If the buffer is too small to hold all of the data, only store the
+      // last part.
+      // TODO: consider moving both the read and the write position accordingly
+      data = ((const uint8_t*) data) + (data_size - size_limit);
+      data_size = size_limit;
+    }
+  } else if (data_size > available_size) {
+    return LFS_ERR_NOSPC;
+  }
+
+  lfs_size_t write_size = header_size + data_size;
+
+  // If we are going to overwrite existing data (i.e., data that would be
+  // returned by a subsequent read request), we need to move the read position
+  // forward. The new read position is only applied after all data has been
+  // written, such that a single commit updates both positions.
+  lfs_size_t overlap_size = 0, n_overwritten = 0;
+  if (skip_padding) {
+    overlap_size = lfs_fromle32(ring->attr_buf.le.write_dist);
+    n_overwritten = lfs_fromle32(ring->attr_buf.le.count);
+  } else if (write_mode == LFSRING_OVERWRITE) {
+    LFSRING_TRACE("write_size=%u available_size=%u", write_size, available_size);
+    if (write_size > available_size) {
+      int err = get_overlap_size(ring, write_size - available_size, &overlap_size, &n_overwritten);
+      if (err) {
+        return err;
+      }
+    }
+  }
+
+  err = ensure_capacity(ring, write_size);
+  if (err) {
+    return err;
+  }
+
+  if (skip_padding) {
+    err = write_object(ring, data, data_size, padding, 0);
+  } else if (ring->mode != LFSRING_MODE_STREAM) {
+    err = write_object(ring, data, data_size, 0, padding);
+  } else {
+    // We have ensured that there is enough space, so write the data.
+    err = do_write(ring, data, data_size, 0);
+  }
+  if (err) {
+    return err;
+  }
+
+  LFSRING_STAT_ADD(ring, bytes_appended, data_size);
+  LFSRING_STAT_ADD(ring, objects_appended, (ring->mode != LFSRING_MODE_STREAM) ? 1 : 0);
+  LFSRING_STAT_ADD(ring, bytes_overwritten, overlap_size);
+  LFSRING_STAT_ADD(ring, objects_overwritten, n_overwritten);
+  LFSRING_STAT_ADD(ring, bytes_padded, padding);
+
+  // Moving the read position forward does not change the write position, so
+  // the new object can be indexed before the write position is updated.
+  advance_read_position(ring, overlap_size, n_overwritten);
+  if (skip_padding) {
+    skip_empty(ring, padding);
+    overlap_size += padding;
+    padding = 0;
+  }
+  index_push(ring, get_pos_w(ring) + padding);
+  advance_write_position(ring, write_size, (ring->mode != LFSRING_MODE_STREAM) ? 1 : 0);
+
+  return commit(ring, overlap_size + write_size);
+}
+
+int lfsring_append(lfsring_t* ring, const void* data, lfs_size_t data_size,
+                   enum lfsring_write_mode write_mode) {
+  LFSRING_TRACE("lfsring_append(%p, %p, %u, %d)", (void*) ring, data, data_size, write_mode);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_append", data_size);
+  LFSRING_TIMER_START(ring);
+  int ret = count_error(ring, append_impl(ring, data, data_size, write_mode));
+  LFSRING_TIMER_STOP(ring, LFSRING_OP_APPEND);
+  LFSRING_EVENT_END(ring, "lfsring_append", ret);
+  return ret;
+}
+
+// Determines how many bytes the given objects occupy when they are written at
+// the write position, including padding.
+static lfs_size_t get_batch_write_size(lfsring_t* ring, const lfsring_object_t* objects,
+                                       lfs_size_t first, lfs_size_t end) {
+  lfs_size_t write_size = 0;
+  for (lfs_size_t i = first; i < end; i++) {
+    lfs_size_t obj_write_size = get_header_size(ring, objects[i].size) + objects[i].size;
+    write_size += get_padding(ring, write_size, obj_write_size) + obj_write_size;
+  }
+  return write_size;
+}
+
+static lfs_ssize_t append_batch_impl(lfsring_t* ring, const lfsring_object_t* objects,
+                                     lfs_size_t n_objects, enum lfsring_write_mode write_mode) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (ring->mode == LFSRING_MODE_FIXED) {
+    for (lfs_size_t i = 0; i < n_objects; i++) {
+      if (objects[i].size != ring->record_size) {
+        return LFS_ERR_INVAL;
+      }
+    }
+  }
+
+  if (write_mode != LFSRING_NO_OVERWRITE && write_mode != LFSRING_OVERWRITE) {
+    return LFS_ERR_INVAL;
+  }
+
+  // There is nothing to commit for an empty batch.
+  if (n_objects == 0) {
+    return 0;
+  }
+
+  // Within a group, the ring buffer might not be allowed to use its entire file.
+  lfs_size_t wanted = 0;
+  if (write_mode == LFSRING_OVERWRITE) {
+    for (lfs_size_t i = 0; i < n_objects && wanted < ring->file_size; i++) {
+      lfs_size_t remaining = ring->file_size - wanted;
+      lfs_size_t header_size = get_header_size(ring, objects[i].size);
+      wanted += (header_size < remaining && objects[i].size < remaining - header_size)
+                ? header_size + objects[i].size : remaining;
+    }
+  }
+  lfs_size_t size_limit;
+  int err = group_make_room(ring, wanted, &size_limit);
+  if (err) {
+    return err;
+  }
+
+  lfs_size_t available_size = size_limit - lfs_fromle32(ring->attr_buf.le.write_dist);
+
+  // An empty ring buffer does not need padding before the first object.
+  if (ring->attr_buf.le.write_dist == 0) {
+    lfs_size_t obj_write_size = get_header_size(ring, objects[0].size) + objects[0].size;
+    skip_empty(ring, get_padding(ring, 0, obj_write_size));
+  }
+
+  // Without LFSRING_OVERWRITE, accept as many objects as fit into the available
+  // space, in order. With LFSRING_OVERWRITE, all objects are accepted, but
+  // only the longest suffix of the batch that fits into the ring buffer needs
+  // to be written since the rest would be overwritten immediately.
+  lfs_size_t first = 0, end = 0;
+  lfs_size_t write_size = 0;
+  if (write_mode == LFSRING_NO_OVERWRITE) {
+    while (end < n_objects) {
+      lfs_size_t header_size = get_header_size(ring, objects[end].size);
+      lfs_size_t overhead = header_size + get_padding(ring, write_size, header_size + objects[end].size);
+      if (available_size - write_size < overhead ||
+          objects[end].size > available_size - write_size - overhead) {
+        break;
+      }
+      write_size += overhead + objects[end].size;
+      end++;
+    }
+
+    if (end == 0) {
+      return LFS_ERR_NOSPC;
+    }
+  } else {
+    // Like lfsring_append, fail if any single object cannot be stored at all.
+    for (lfs_size_t i = 0; i < n_objects; i++) {
+      lfs_size_t header_size = get_header_size(ring, objects[i].size);
+      if (size_limit < header_size || objects[i].size > size_limit - header_size) {
+        return LFS_ERR_NOSPC;
+      }
+    }
+
+    first = end = n_objects;
+    while (first > 0) {
+      lfs_size_t obj_write_size = get_header_size(ring, objects[first - 1].size) + objects[first - 1].size;
+      if (obj_write_size > size_limit - write_size) {
+        break;
+      }
+      write_size += obj_write_size;
+      first--;
+    }
+
+    LFS_ASSERT(first < end);
+  }
+
+  // If leading objects of the batch are discarded, all data that is already in
+  // the ring buffer is older and would have been overwritten before them. The
+  // same holds if the batch only fits without the padding that it would need
+  // after the existing data. The batch is then written at the beginning of the
+  // file, where it does not need any padding.
+  lfs_size_t overlap_size = 0, n_overwritten = 0;
+  lfs_size_t skipped = 0;
+  if (write_mode == LFSRING_OVERWRITE) {
+    lfs_size_t padded_size = get_batch_write_size(ring, objects, first, end);
+    if (first > 0 || padded_size > size_limit) {
+      overlap_size = lfs_fromle32(ring->attr_buf.le.write_dist);
+      n_overwritten = lfs_fromle32(ring->attr_buf.le.count);
+      if (ring->wrap_free) {
+        lfs_off_t write_offset = get_file_offset(ring, get_pos_w(ring));
+        skipped = (write_offset != 0) ? ring->capacity - write_offset : 0;
+      }
+    } else {
+      write_size = padded_size;
+      if (write_size > available_size) {
+        err = get_overlap_size(ring, write_size - available_size, &overlap_size, &n_overwritten);
+        if (err) {
+          return err;
+        }
+      }
+    }
+  }
+
+  err = ensure_capacity(ring, write_size);
+  if (err) {
+    return err;
+  }
+
+  lfs_off_t rel_off = skipped;
+  lfs_size_t total_padding = 0;
+  for (lfs_size_t i = first; i < end; i++) {
+    lfs_size_t obj_write_size = get_header_size(ring, objects[i].size) + objects[i].size;
+    lfs_size_t padding = get_padding(ring, rel_off, obj_write_size);
+    err = write_object(ring, objects[i].data, objects[i].size, rel_off, padding);
+    if (err) {
+      return err;
+    }
+    rel_off += padding + obj_write_size;
+    total_padding += padding;
+    LFSRING_STAT_ADD(ring, bytes_appended, objects[i].size);
+  }
+  LFS_ASSERT(rel_off == skipped + write_size);
+
+  LFSRING_STAT_ADD(ring, objects_appended, end - first);
+  LFSRING_STAT_ADD(ring, bytes_overwritten, overlap_size);
+  LFSRING_STAT_ADD(ring, objects_overwritten, n_overwritten);
+  LFSRING_STAT_ADD(ring, bytes_padded, total_padding);
+
+  advance_read_position(ring, overlap_size, n_overwritten);
+  if (skipped != 0) {
+    skip_empty(ring, skipped);
+    overlap_size += skipped;
+  }
+  rel_off = 0;
+  for (lfs_size_t i = first; i < end; i++) {
+    lfs_size_t obj_write_size = get_header_size(ring, objects[i].size) + objects[i].size;
+    rel_off += get_padding(ring, rel_off, obj_write_size);
+    index_push(ring, get_pos_w(ring) + rel_off);
+    rel_off += obj_write_size;
+  }
+  advance_write_position(ring, write_size, end - first);
+
+  err = commit(ring, overlap_size + write_size);
+  if (err) {
+    return err;
+  }
+
+  return end;
+}
+
+lfs_ssize_t lfsring_append_batch(lfsring_t* ring, const lfsring_object_t* objects,
+                                 lfs_size_t n_objects, enum lfsring_write_mode write_mode) {
+  LFSRING_TRACE("lfsring_append_batch(%p, %p, %u, %d)", (void*) ring, (const void*) objects, n_objects, write_mode);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_append_batch", n_objects);
+  lfs_ssize_t ret = count_error(ring, append_batch_impl(ring, objects, n_objects, write_mode));
+  LFSRING_EVENT_END(ring, "lfsring_append_batch", ret);
+  return ret;
+}
+
+// Reads the first object, or the first bytes in stream mode. Sets padding to
+// the number of bytes that precede the object.
+static lfs_ssize_t peek_impl(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                             lfs_off_t* padding) {
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  *padding = 0;
+
+  if (ring->mode != LFSRING_MODE_STREAM) {
+    if (avail == 0) {
+      // Unlike in stream mode, we cannot return 0 here because objects can be
+      // empty (i.e., have a size of 0 bytes) and the caller must be able to
+      // distinguish between "no object" and "empty object".
+      return LFS_ERR_NOENT;
+    } else {
+      // Read the size of the object first.
+      lfs_size_t obj_size;
+      int err = read_object_size(ring, padding, avail, &obj_size);
+      if (err) {
+        return err;
+      }
+      // If the buffer provided by the user is too small to retrieve the entire
+      // object, fail to ensure that objects are only retrieved as a whole.
+      if (obj_size > buffer_size) {
+        return LFS_ERR_NOMEM;
+      }
+      buffer_size = obj_size;
+    }
+  } else {
+    // Do not read more bytes than available.
+    buffer_size = lfs_min(avail, buffer_size);
+  }
+
+  int err = read_object_data(ring, buffer, buffer_size, *padding);
+  if (err) {
+    return err;
+  }
+
+  LFSRING_STAT_ADD(ring, bytes_read, buffer_size);
+  return buffer_size;
+}
+
+lfs_ssize_t lfsring_peek(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_peek(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_peek", buffer_size);
+  LFSRING_TIMER_START(ring);
+  lfs_off_t padding;
+  lfs_ssize_t ret = count_error(ring, peek_impl(ring, buffer, buffer_size, &padding));
+  LFSRING_TIMER_STOP(ring, LFSRING_OP_PEEK);
+  LFSRING_EVENT_END(ring, "lfsring_peek", ret);
+  return ret;
+}
+
+static lfs_ssize_t take_impl(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_off_t padding;
+  lfs_ssize_t ret = peek_impl(ring, buffer, buffer_size, &padding);
+  if (ret < 0) {
+    return ret;
+  }
+
+  LFS_ASSERT((lfs_size_t) ret <= buffer_size);
+
+  lfs_size_t distance = padding + get_header_size(ring, ret) + (lfs_size_t) ret;
+  lfs_size_t n_objects = (ring->mode != LFSRING_MODE_STREAM) ? 1 : 0;
+  LFSRING_STAT_ADD(ring, bytes_consumed, distance);
+  LFSRING_STAT_ADD(ring, objects_consumed, n_objects);
+  advance_read_position(ring, distance, n_objects);
+
+  int err = commit(ring, distance);
+  if (err) {
+    return err;
+  }
+
+  return ret;
+}
+
+lfs_ssize_t lfsring_take(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_take(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_take", buffer_size);
+  LFSRING_TIMER_START(ring);
+  lfs_ssize_t ret = count_error(ring, take_impl(ring, buffer, buffer_size));
+  LFSRING_TIMER_STOP(ring, LFSRING_OP_TAKE);
+  LFSRING_EVENT_END(ring, "lfsring_take", ret);
+  return ret;
+}
+
+static lfs_ssize_t take_many_impl(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                                  lfs_size_t* sizes, lfs_size_t max_objects) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  if (avail == 0) {
+    return LFS_ERR_NOENT;
+  }
+
+  // There is nothing to commit if no objects are requested.
+  if (max_objects == 0) {
+    return 0;
+  }
+
+  lfs_off_t taken = 0;
+  lfs_size_t used = 0;
+  lfs_size_t n_objects = 0;
+  while (n_objects < max_objects && taken < avail) {
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, &taken, avail - taken, &obj_size);
+    if (err) {
+      return err;
+    }
+
+    // Only retrieve objects as a whole. If not even the first object fits into
+    // the buffer, fail just like lfsring_take.
+    if (obj_size > buffer_size - used) {
+      if (n_objects == 0) {
+        return LFS_ERR_NOMEM;
+      }
+      break;
+    }
+
+    err = read_object_data(ring, ((uint8_t*) buffer) + used, obj_size, taken);
+    if (err) {
+      return err;
+    }
+
+    sizes[n_objects++] = obj_size;
+    used += obj_size;
+    taken += get_header_size(ring, obj_size) + obj_size;
+  }
+
+  LFSRING_STAT_ADD(ring, bytes_read, used);
+  LFSRING_STAT_ADD(ring, bytes_consumed, taken);
+  LFSRING_STAT_ADD(ring, objects_consumed, n_objects);
+  advance_read_position(ring, taken, n_objects);
+
+  int err = commit(ring, taken);
+  if (err) {
+    return err;
+  }
+
+  return n_objects;
+}
+
+lfs_ssize_t lfsring_take_many(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                              lfs_size_t* sizes, lfs_size_t max_objects) {
+  LFSRING_TRACE("lfsring_take_many(%p, %p, %u, %p, %u)", (void*) ring, buffer, buffer_size, (void*) sizes, max_objects);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_take_many", buffer_size);
+  lfs_ssize_t ret = count_error(ring, take_many_impl(ring, buffer, buffer_size, sizes, max_objects));
+  LFSRING_EVENT_END(ring, "lfsring_take_many", ret);
+  return ret;
+}
+
+// Passes size bytes, starting at the given distance from the read position, to
+// the callback, one chunk at a time. Chunks never cross the end of the file or
+// a multiple of the buffer size, such that reads align with the littlefs cache
+// if the buffer size is equal to the cache size.
+static int visit_range(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                       lfs_off_t rel_off, lfs_size_t size, lfsring_chunk_t* chunk,
+                       lfsring_visit_cb cb, void* ctx) {
+  chunk->data = buffer;
+  chunk->offset = 0;
+
+  do {
+    lfs_off_t file_offset = get_file_offset(ring, get_pos_r(ring) + rel_off + chunk->offset);
+    lfs_size_t chunk_size = buffer_size - file_offset % buffer_size;
+    chunk_size = lfs_min(chunk_size, ring->capacity - file_offset);
+    chunk_size = lfs_min(chunk_size, size - chunk->offset);
+
+    int err = do_read(ring, buffer, chunk_size, rel_off + chunk->offset);
+    if (err) {
+      return err;
+    }
+    LFSRING_STAT_ADD(ring, bytes_read, chunk_size);
+
+    chunk->size = chunk_size;
+    int ret = cb(ctx, chunk);
+    if (ret != 0) {
+      return ret;
+    }
+
+    chunk->offset += chunk_size;
+  } while (chunk->offset < size);
+
+  return 0;
+}
+
+static lfs_ssize_t visit_impl(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                              lfs_size_t max_bytes, lfsring_visit_cb cb, void* ctx) {
+  if (buffer_size == 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfsring_chunk_t chunk;
+
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    lfs_size_t size = lfs_min(avail, max_bytes);
+    if (size == 0) {
+      return 0;
+    }
+
+    chunk.total_size = size;
+    int ret = visit_range(ring, buffer, buffer_size, 0, size, &chunk, cb, ctx);
+    if (ret < 0) {
+      return ret;
+    } else if (ret > 0) {
+      // The callback stopped after the current chunk.
+      return chunk.offset + chunk.size;
+    }
+
+    return size;
+  }
+
+  lfs_off_t visited = 0;
+  lfs_size_t visited_bytes = 0;
+  lfs_size_t n_objects = 0;
+  while (visited < avail) {
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, &visited, avail - visited, &obj_size);
+    if (err) {
+      return err;
+    }
+
+    if (obj_size > max_bytes - visited_bytes) {
+      break;
+    }
+
+    int ret;
+    chunk.total_size = obj_size;
+    if (obj_size == 0) {
+      // Empty objects consist of a single empty chunk.
+      chunk.data = buffer;
+      chunk.offset = 0;
+      chunk.size = 0;
+      ret = cb(ctx, &chunk);
+    } else {
+      ret = visit_range(ring, buffer, buffer_size, visited + get_header_size(ring, obj_size), obj_size, &chunk, cb, ctx);
+    }
+
+    if (ret < 0) {
+      return ret;
+    } else if (ret > 0) {
+      // Only count the current object if the callback has seen all of it.
+      if (chunk.offset + chunk.size == obj_size) {
+        n_objects++;
+      }
+      break;
+    }
+
+    visited += get_header_size(ring, obj_size) + obj_size;
+    visited_bytes += obj_size;
+    n_objects++;
+  }
+
+  return n_objects;
+}
+
+lfs_ssize_t lfsring_visit(lfsring_t* ring, void* buffer, lfs_size_t buffer_size,
+                          lfs_size_t max_bytes, lfsring_visit_cb cb, void* ctx) {
+  LFSRING_TRACE("lfsring_visit(%p, %p, %u, %u, %p, %p)", (void*) ring, buffer, buffer_size, max_bytes, (void*) cb, ctx);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_visit", max_bytes);
+  lfs_ssize_t ret = count_error(ring, visit_impl(ring, buffer, buffer_size, max_bytes, cb, ctx));
+  LFSRING_EVENT_END(ring, "lfsring_visit", ret);
+  return ret;
+}
+
+static lfs_ssize_t verify_impl(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
+  if (!ring->checksums || buffer_size == 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  lfs_off_t rel_off = 0;
+  lfs_size_t n_objects = 0;
+  while (rel_off < avail) {
+    lfs_size_t obj_size;
+    int err = read_object_size(ring, &rel_off, avail - rel_off, &obj_size);
+    if (err) {
+      return err;
+    }
+
+    lfs_size_t header_size = get_header_size(ring, obj_size);
+    uint32_t checksum;
+    err = do_read(ring, &checksum, sizeof(checksum), rel_off + header_size - sizeof(checksum));
+    if (err) {
+      return err;
+    }
+
+    // Objects do not need to fit into the buffer.
+    uint32_t crc = 0;
+    for (lfs_size_t done = 0; done < obj_size;) {
+      lfs_size_t n = lfs_min(buffer_size, obj_size - done);
+      err = do_read(ring, buffer, n, rel_off + header_size + done);
+      if (err) {
+        return err;
+      }
+      crc = crc32c(crc, buffer, n);
+      done += n;
+    }
+
+    if (crc != lfs_fromle32(checksum)) {
+      return LFS_ERR_CORRUPT;
+    }
+
+    rel_off += header_size + obj_size;
+    n_objects++;
+  }
+
+  return n_objects;
+}
+
+lfs_ssize_t lfsring_verify(lfsring_t* ring, void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_verify(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_verify", buffer_size);
+  lfs_ssize_t ret = count_error(ring, verify_impl(ring, buffer, buffer_size));
+  LFSRING_EVENT_END(ring, "lfsring_verify", ret);
+  return ret;
+}
+
+static int drop_impl(lfsring_t* ring, lfs_off_t n) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    if (n > avail) {
+      return LFS_ERR_INVAL;
+    }
+
+    LFSRING_STAT_ADD(ring, bytes_consumed, n);
+    advance_read_position(ring, n, 0);
+    return commit(ring, n);
+  } else {
+    lfs_off_t dropped;
+    int err = find_object(ring, n, &dropped);
+    if (err) {
+      return err;
+    }
+
+    LFSRING_STAT_ADD(ring, bytes_consumed, dropped);
+    LFSRING_STAT_ADD(ring, objects_consumed, n);
+    advance_read_position(ring, dropped, n);
+    return commit(ring, dropped);
+  }
+}
+
+int lfsring_drop(lfsring_t* ring, lfs_off_t n) {
+  LFSRING_TRACE("lfsring_drop(%p, %u)", (void*) ring, n);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_drop", n);
+  LFSRING_TIMER_START(ring);
+  int ret = count_error(ring, drop_impl(ring, n));
+  LFSRING_TIMER_STOP(ring, LFSRING_OP_DROP);
+  LFSRING_EVENT_END(ring, "lfsring_drop", ret);
+  return ret;
+}
+
+static int cursor_init_impl(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    return LFS_ERR_INVAL;
+  }
+
+  cursor->pos = get_pos_r(ring);
+  cursor->seq = ring->head_seq;
+  cursor->has_obj_size = false;
+  return 0;
+}
+
+int lfsring_cursor_init(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  LFSRING_TRACE("lfsring_cursor_init(%p, %p)", (void*) ring, (void*) cursor);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_init", 0);
+  int ret = count_error(ring, cursor_init_impl(ring, cursor));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_init", ret);
+  return ret;
+}
+
+static int cursor_seek_impl(lfsring_t* ring, lfsring_cursor_t* cursor, lfs_size_t n) {
+  if (ring->mode == LFSRING_MODE_STREAM) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_off_t rel_off;
+  int err = find_object(ring, n, &rel_off);
+  if (err) {
+    return err;
+  }
+
+  cursor->pos = get_pos_r(ring) + rel_off;
+  cursor->seq = ring->head_seq + n;
+  cursor->has_obj_size = false;
+  return 0;
+}
+
+int lfsring_cursor_seek(lfsring_t* ring, lfsring_cursor_t* cursor, lfs_size_t n) {
+  LFSRING_TRACE("lfsring_cursor_seek(%p, %p, %u)", (void*) ring, (void*) cursor, n);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_seek", n);
+  int ret = count_error(ring, cursor_seek_impl(ring, cursor, n));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_seek", ret);
+  return ret;
+}
+
+// Determines the distance between the read position and the cursor, and reads
+// the size of the object at the cursor unless it is already known.
+static int load_cursor(lfsring_t* ring, lfsring_cursor_t* cursor, lfs_off_t* rel_off) {
+  uint64_t pos_r = get_pos_r(ring);
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+
+  // The object that the cursor points to has been removed.
+  if (cursor->pos < pos_r || cursor->pos - pos_r > avail) {
+    return LFS_ERR_INVAL;
+  }
+
+  *rel_off = cursor->pos - pos_r;
+  if (*rel_off == avail) {
+    return LFS_ERR_NOENT;
+  }
+
+  if (!cursor->has_obj_size) {
+    int err = read_object_size(ring, rel_off, avail - *rel_off, &cursor->obj_size);
+    if (err) {
+      return err;
+    }
+    cursor->pos = pos_r + *rel_off;
+    cursor->has_obj_size = true;
+  }
+
+  return 0;
+}
+
+static lfs_ssize_t cursor_size_impl(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  lfs_off_t rel_off;
+  int err = load_cursor(ring, cursor, &rel_off);
+  if (err) {
+    return err;
+  }
+
+  return cursor->obj_size;
+}
+
+lfs_ssize_t lfsring_cursor_size(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  LFSRING_TRACE("lfsring_cursor_size(%p, %p)", (void*) ring, (void*) cursor);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_size", 0);
+  lfs_ssize_t ret = count_error(ring, cursor_size_impl(ring, cursor));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_size", ret);
+  return ret;
+}
+
+static lfs_ssize_t cursor_peek_impl(lfsring_t* ring, lfsring_cursor_t* cursor,
+                                    void* buffer, lfs_size_t buffer_size) {
+  lfs_off_t rel_off;
+  int err = load_cursor(ring, cursor, &rel_off);
+  if (err) {
+    return err;
+  }
+
+  if (cursor->obj_size > buffer_size) {
+    return LFS_ERR_NOMEM;
+  }
+
+  err = read_object_data(ring, buffer, cursor->obj_size, rel_off);
+  if (err) {
+    return err;
+  }
+
+  LFSRING_STAT_ADD(ring, bytes_read, cursor->obj_size);
+  return cursor->obj_size;
+}
+
+lfs_ssize_t lfsring_cursor_peek(lfsring_t* ring, lfsring_cursor_t* cursor,
+                                void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_cursor_peek(%p, %p, %p, %u)", (void*) ring, (void*) cursor, buffer, buffer_size);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_peek", buffer_size);
+  lfs_ssize_t ret = count_error(ring, cursor_peek_impl(ring, cursor, buffer, buffer_size));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_peek", ret);
+  return ret;
+}
+
+static int cursor_next_impl(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  lfs_off_t rel_off;
+  int err = load_cursor(ring, cursor, &rel_off);
+  if (err) {
+    return err;
+  }
+
+  cursor->pos += get_header_size(ring, cursor->obj_size) + cursor->obj_size;
+  cursor->seq++;
+  cursor->has_obj_size = false;
+  return 0;
+}
+
+int lfsring_cursor_next(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  LFSRING_TRACE("lfsring_cursor_next(%p, %p)", (void*) ring, (void*) cursor);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_next", 0);
+  int ret = count_error(ring, cursor_next_impl(ring, cursor));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_next", ret);
+  return ret;
+}
+
+static int cursor_drop_impl(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  uint64_t pos_r = get_pos_r(ring);
+  lfs_size_t avail = lfs_fromle32(ring->attr_buf.le.write_dist);
+  if (cursor->pos < pos_r || cursor->pos - pos_r > avail) {
+    return LFS_ERR_INVAL;
+  }
+
+  lfs_size_t distance = cursor->pos - pos_r;
+  LFSRING_STAT_ADD(ring, bytes_consumed, distance);
+  LFSRING_STAT_ADD(ring, objects_consumed, cursor->seq - ring->head_seq);
+  advance_read_position(ring, distance, cursor->seq - ring->head_seq);
+  return commit(ring, distance);
+}
+
+int lfsring_cursor_drop(lfsring_t* ring, lfsring_cursor_t* cursor) {
+  LFSRING_TRACE("lfsring_cursor_drop(%p, %p)", (void*) ring, (void*) cursor);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_cursor_drop", 0);
+  int ret = count_error(ring, cursor_drop_impl(ring, cursor));
+  LFSRING_EVENT_END(ring, "lfsring_cursor_drop", ret);
+  return ret;
+}
+
+static int resize_impl(lfsring_t* ring, lfs_size_t new_size) {
+  if (ring->read_only) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (new_size == 0 || (ring->mode == LFSRING_MODE_FIXED && new_size < ring->record_size)) {
+    return LFS_ERR_INVAL;
+  }
+
+  // Discard the oldest data if necessary.
+  lfs_size_t used = lfs_fromle32(ring->attr_buf.le.write_dist);
+  if (used > new_size) {
+    lfs_size_t overlap_size, n_overwritten;
+    int err = get_overlap_size(ring, used - new_size, &overlap_size, &n_overwritten);
+    if (err) {
+      return err;
+    }
+
+    LFSRING_STAT_ADD(ring, bytes_overwritten, overlap_size);
+    LFSRING_STAT_ADD(ring, objects_overwritten, n_overwritten);
+    advance_read_position(ring, overlap_size, n_overwritten);
+  }
+
+  // Elastic ring buffers only need to shrink if their capacity exceeds the new
+  // size, otherwise, the whole file is in use.
+  lfs_size_t new_capacity = ring->elastic ? lfs_min(ring->capacity, new_size) : new_size;
+  if (new_capacity != ring->capacity) {
+    int err = relocate(ring, new_capacity);
+    if (err) {
+      return err;
+    }
+  }
+
+  ring->file_size = new_size;
+  ring->attr_buf.le.file_size = lfs_tole32(new_size);
+  return do_sync(ring);
+}
+
+int lfsring_resize(lfsring_t* ring, lfs_size_t new_size) {
+  LFSRING_TRACE("lfsring_resize(%p, %u)", (void*) ring, new_size);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_resize", new_size);
+  int ret = count_error(ring, resize_impl(ring, new_size));
+  LFSRING_EVENT_END(ring, "lfsring_resize", ret);
+  return ret;
+}
+
+static int flush_impl(lfsring_t* ring) {
+  if (ring->unsynced_ops == 0) {
+    return 0;
+  }
+
+  return do_sync(ring);
+}
+
+int lfsring_flush(lfsring_t* ring) {
+  LFSRING_TRACE("lfsring_flush(%p)", (void*) ring);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_flush", 0);
+  int ret = count_error(ring, flush_impl(ring));
+  LFSRING_EVENT_END(ring, "lfsring_flush", ret);
+  return ret;
+}
+
+static int close_impl(lfsring_t* ring) {
+  lfsring_group_remove(ring);
+  int read_err = 0;
+  if (ring->read_file_open) {
+    ring->read_file_open = false;
+    read_err = lfs_file_close(ring->backend, &ring->read_file);
+  }
+  int err = lfs_file_close(ring->backend, &ring->file);
+  return err ? err : read_err;
+}
+
+int lfsring_close(lfsring_t* ring) {
+  LFSRING_TRACE("lfsring_close(%p)", (void*) ring);
+  LFSRING_EVENT_BEGIN(ring, "lfsring_close", 0);
+  int ret = count_error(ring, close_impl(ring));
+  LFSRING_EVENT_END(ring, "lfsring_close", ret);
+  return ret;
+}
+
+void lfsring_group_init(lfsring_group_t* group, lfs_size_t budget) {
+  group->budget = budget;
+  group->rings = NULL;
+}
+
+void lfsring_group_add(lfsring_group_t* group, lfsring_t* ring, lfs_size_t min_size,
+                       uint32_t weight) {
+  LFSRING_TRACE("lfsring_group_add(%p, %p, %u, %u)", (void*) group, (void*) ring, min_size, weight);
+  lfsring_group_remove(ring);
+  ring->group = group;
+  ring->group_min = min_size;
+  ring->group_weight = weight;
+  ring->group_next = group->rings;
+  group->rings = ring;
+}
+
+void lfsring_group_remove(lfsring_t* ring) {
+  if (ring->group == NULL) {
+    return;
+  }
+
+  lfsring_t** link = &ring->group->rings;
+  while (*link != ring) {
+    link = &(*link)->group_next;
+  }
+  *link = ring->group_next;
+  ring->group = NULL;
+}
+
+lfs_size_t lfsring_group_used_bytes(lfsring_group_t* group) {
+  lfs_size_t used = 0;
+  for (lfsring_t* ring = group->rings; ring != NULL; ring = ring->group_next) {
+    used += lfs_fromle32(ring->attr_buf.le.write_dist);
+  }
+  return used;
+}
+
+#ifdef LFSRING_YES_HISTOGRAMS
+void lfsring_get_histograms(lfsring_t* ring, lfsring_histograms_t* histograms) {
+  *histograms = ring->histograms;
+}
+
+void lfsring_reset_histograms(lfsring_t* ring) {
+  memset(&ring->histograms, 0, sizeof(ring->histograms));
+}
+#endif
+
+#ifdef LFSRING_YES_STATS
+void lfsring_get_stats(lfsring_t* ring, lfsring_stats_t* stats) {
+  *stats = ring->stats;
+}
+
+void lfsring_reset_stats(lfsring_t* ring) {
+  memset(&ring->stats, 0, sizeof(ring->stats));
+}
+#endif
+
+static inline lfs_size_t seg_first(lfsring_seg_t* ring) {
+  return lfs_fromle32(ring->attr_buf.le.first_seg);
+}
+
+static inline lfs_off_t seg_read_off(lfsring_seg_t* ring) {
+  return lfs_fromle32(ring->attr_buf.le.read_off);
+}
+
+static inline void seg_set_read_pos(lfsring_seg_t* ring, lfs_size_t first, lfs_off_t read_off) {
+  ring->attr_buf.le.first_seg = lfs_tole32(first);
+  ring->attr_buf.le.read_off = lfs_tole32(read_off);
+}
+
+static inline lfs_size_t seg_header_size(lfsring_seg_t* ring) {
+  return (ring->mode == LFSRING_MODE_OBJECT) ? sizeof(lfs_size_t) : 0;
+}
+
+// Returns the path of the segment file with the given number. Segment files are
+// named after their number in hexadecimal notation, such that the names of all
+// segments have the same length.
+static const char* seg_path(lfsring_seg_t* ring, lfs_size_t seg) {
+  static const char digits[] = "0123456789abcdef";
+  for (int i = 7; i >= 0; i--) {
+    ring->path[ring->path_len + i] = digits[seg & 0xf];
+    seg >>= 4;
+  }
+  ring->path[ring->path_len + 8] = '\0';
+  return ring->path;
+}
+
+// Parses the name of a segment file. Returns false if the name is not the name
+// of a segment file.
+static bool seg_parse_name(const char* name, lfs_size_t* seg) {
+  *seg = 0;
+  for (int i = 0; i < 8; i++) {
+    char c = name[i];
+    if (c >= '0' && c <= '9') {
+      *seg = (*seg << 4) | (lfs_size_t) (c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      *seg = (*seg << 4) | (lfs_size_t) (c - 'a' + 10);
+    } else {
+      return false;
+    }
+  }
+  return name[8] == '\0';
+}
+
+static int seg_open_tail(lfsring_seg_t* ring) {
+  int flags = LFS_O_CREAT | LFS_O_RDWR | LFS_O_APPEND;
+  return lfs_file_opencfg(ring->backend, &ring->file, seg_path(ring, ring->last_seg), flags,
+                          &ring->file_config);
+}
+
+static int seg_close_read_file(lfsring_seg_t* ring) {
+  if (!ring->read_file_open) {
+    return 0;
+  }
+  ring->read_file_open = false;
+  return lfs_file_close(ring->backend, &ring->read_file);
+}
+
+// Removes the segment files first..end-1, which must not be in use anymore.
+static int seg_remove(lfsring_seg_t* ring, lfs_size_t first, lfs_size_t end) {
+  if (ring->read_file_open && ring->read_seg != seg_first(ring)) {
+    int err = seg_close_read_file(ring);
+    if (err) {
+      return err;
+    }
+  }
+
+  for (lfs_size_t seg = first; seg != end; seg++) {
+    int err = lfs_remove(ring->backend, seg_path(ring, seg));
+    // The segment might have been removed already before a power loss.
+    if (err && err != LFS_ERR_NOENT) {
+      return err;
+    }
+  }
+
+  return 0;
+}
+
+int lfsring_seg_open(lfsring_seg_t* ring, lfs_t* lfs, const char* path,
+                     const lfsring_seg_config_t* config) {
+  LFSRING_TRACE("lfsring_seg_open(%p, %p, \"%s\", %p {  })", (void*) ring, (void*) lfs, path, (void*) config);
+
+  if (config->mode != LFSRING_MODE_OBJECT && config->mode != LFSRING_MODE_FIXED) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (config->mode == LFSRING_MODE_FIXED && config->record_size == 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (config->segment_count == 0 || config->segment_size == 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  size_t path_len = strlen(path);
+  if (path_len + 10 > sizeof(ring->path)) {
+    return LFS_ERR_NAMETOOLONG;
+  }
+  memcpy(ring->path, path, path_len);
+  ring->path[path_len] = '/';
+
+  ring->backend = lfs;
+  ring->path_len = path_len + 1;
+  ring->segment_size = config->segment_size;
+  ring->segment_count = config->segment_count;
+  ring->mode = config->mode;
+  ring->record_size = config->record_size;
+  ring->read_file_open = false;
+
+  ring->attr.type = config->attr_metadata;
+  ring->attr.buffer = ring->attr_buf.bytes;
+  ring->attr.size = sizeof(ring->attr_buf.bytes);
+
+  LFS_ASSERT(sizeof(ring->attr_buf.bytes) == sizeof(ring->attr_buf));
+
+  memset(&ring->file_config, 0, sizeof(ring->file_config));
+  ring->file_config.buffer = config->file_buffer;
+  ring->file_config.attrs = &ring->attr;
+  ring->file_config.attr_count = 1;
+
+  memset(&ring->read_file_config, 0, sizeof(ring->read_file_config));
+  ring->read_file_config.buffer = config->read_buffer;
+
+  int err = lfs_mkdir(lfs, path);
+  if (err && err != LFS_ERR_EXIST) {
+    return err;
+  }
+
+  // Find the oldest and the newest segment.
+  lfs_dir_t dir;
+  ring->path[path_len] = '\0';
+  err = lfs_dir_open(lfs, &dir, ring->path);
+  ring->path[path_len] = '/';
+  if (err) {
+    return err;
+  }
+
+  bool found = false;
+  lfs_size_t min_seg = 0, max_seg = 0;
+  struct lfs_info info;
+  int res;
+  while ((res = lfs_dir_read(lfs, &dir, &info)) > 0) {
+    lfs_size_t seg;
+    if (info.type != LFS_TYPE_REG || !seg_parse_name(info.name, &seg)) {
+      continue;
+    }
+    if (!found || seg < min_seg) {
+      min_seg = seg;
+    }
+    if (!found || seg > max_seg) {
+      max_seg = seg;
+    }
+    found = true;
+  }
+
+  err = lfs_dir_close(lfs, &dir);
+  if (res < 0) {
+    return res;
+  }
+  if (err) {
+    return err;
+  }
+
+  // The read position is stored in the newest segment. If a power loss occurred
+  // after a new segment was created but before it was synced for the first
+  // time, the new segment does not have the attribute and can be discarded.
+  memset(ring->attr_buf.bytes, 0, sizeof(ring->attr_buf.bytes));
+  seg_set_read_pos(ring, max_seg, 0);
+  while (found) {
+    lfs_ssize_t attr_size = lfs_getattr(lfs, seg_path(ring, max_seg), config->attr_metadata,
+                                        ring->attr_buf.bytes, sizeof(ring->attr_buf.bytes));
+    if (attr_size >= 0) {
+      if ((lfs_size_t) attr_size != sizeof(ring->attr_buf.bytes) ||
+          seg_first(ring) > max_seg || seg_first(ring) < min_seg) {
+        return LFS_ERR_CORRUPT;
+      }
+      break;
+    } else if (attr_size != LFS_ERR_NOATTR) {
+      return attr_size;
+    }
+
+    if (min_seg == max_seg) {
+      seg_set_read_pos(ring, max_seg, 0);
+      break;
+    }
+
+    err = lfs_remove(lfs, seg_path(ring, max_seg));
+    if (err) {
+      return err;
+    }
+    max_seg--;
+  }
+
+  ring->last_seg = max_seg;
+  err = seg_open_tail(ring);
+  if (err) {
+    return err;
+  }
+
+  // Remove segments that have been consumed before a power loss occurred.
+  err = seg_remove(ring, min_seg, seg_first(ring));
+  if (err) {
+    lfs_file_close(lfs, &ring->file);
+    return err;
+  }
+
+  return 0;
+}
+
+// Returns the file that contains the oldest object, opening it if necessary.
+static int seg_head(lfsring_seg_t* ring, lfs_file_t** file) {
+  lfs_size_t first = seg_first(ring);
+  if (first == ring->last_seg) {
+    *file = &ring->file;
+    return 0;
+  }
+
+  if (ring->read_file_open && ring->read_seg != first) {
+    int err = seg_close_read_file(ring);
+    if (err) {
+      return err;
+    }
+  }
+
+  if (!ring->read_file_open) {
+    int err = lfs_file_opencfg(ring->backend, &ring->read_file, seg_path(ring, first), LFS_O_RDONLY,
+                               &ring->read_file_config);
+    if (err) {
+      return err;
+    }
+    ring->read_file_open = true;
+    ring->read_seg = first;
+  }
+
+  *file = &ring->read_file;
+  return 0;
+}
+
+// Determines the size of the next object. Returns LFS_ERR_NOENT if the ring
+// buffer is empty.
+static int seg_read_object_size(lfsring_seg_t* ring, lfs_file_t** file, lfs_size_t* obj_size) {
+  int err = seg_head(ring, file);
+  if (err) {
+    return err;
+  }
+
+  lfs_soff_t file_size = lfs_file_size(ring->backend, *file);
+  if (file_size < 0) {
+    return file_size;
+  }
+
+  lfs_off_t read_off = seg_read_off(ring);
+  if (read_off > (lfs_off_t) file_size) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  lfs_size_t avail = (lfs_off_t) file_size - read_off;
+  if (avail == 0) {
+    // Only the newest segment can be consumed entirely.
+    return (*file == &ring->file) ? LFS_ERR_NOENT : LFS_ERR_CORRUPT;
+  }
+
+  if (ring->mode == LFSRING_MODE_FIXED) {
+    if (avail < ring->record_size) {
+      return LFS_ERR_CORRUPT;
+    }
+    *obj_size = ring->record_size;
+    return 0;
+  }
+
+  if (avail < sizeof(lfs_size_t)) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  lfs_soff_t seeked = lfs_file_seek(ring->backend, *file, read_off, LFS_SEEK_SET);
+  if (seeked < 0) {
+    return seeked;
+  }
+
+  lfs_ssize_t n_read = lfs_file_read(ring->backend, *file, obj_size, sizeof(*obj_size));
+  if (n_read < 0) {
+    return n_read;
+  }
+  if ((lfs_size_t) n_read < sizeof(*obj_size)) {
+    return LFS_ERR_CORRUPT;
+  }
+  *obj_size = lfs_fromle32(*obj_size);
+
+  if (avail - sizeof(lfs_size_t) < *obj_size) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  return 0;
+}
+
+// Moves the read position past the next object, whose size must be obj_size,
+// and moves on to the next segment once the oldest segment has been consumed.
+static int seg_advance(lfsring_seg_t* ring, lfs_file_t* file, lfs_size_t obj_size) {
+  lfs_soff_t file_size = lfs_file_size(ring->backend, file);
+  if (file_size < 0) {
+    return file_size;
+  }
+
+  lfs_size_t first = seg_first(ring);
+  lfs_off_t read_off = seg_read_off(ring) + seg_header_size(ring) + obj_size;
+  LFS_ASSERT(read_off <= (lfs_off_t) file_size);
+  if (read_off == (lfs_off_t) file_size && first != ring->last_seg) {
+    first++;
+    read_off = 0;
+  }
+
+  seg_set_read_pos(ring, first, read_off);
+  return 0;
+}
+
+// Commits the read position, as well as data written to the newest segment,
+// and removes segments that have been consumed. If the ring buffer is empty,
+// the newest segment is truncated such that it can be reused.
+static int seg_commit(lfsring_seg_t* ring, lfs_size_t old_first) {
+  lfs_size_t first = seg_first(ring);
+  if (first == ring->last_seg && seg_read_off(ring) != 0) {
+    lfs_soff_t file_size = lfs_file_size(ring->backend, &ring->file);
+    if (file_size < 0) {
+      return file_size;
+    }
+    if (seg_read_off(ring) == (lfs_off_t) file_size) {
+      int err = lfs_file_truncate(ring->backend, &ring->file, 0);
+      if (err) {
+        return err;
+      }
+      seg_set_read_pos(ring, first, 0);
+    }
+  }
+
+  // See do_sync.
+  ring->file.flags |= LFS_F_DIRTY;
+
+  int err = lfs_file_sync(ring->backend, &ring->file);
+  if (err) {
+    return err;
+  }
+
+  return seg_remove(ring, old_first, first);
+}
+
+bool lfsring_seg_is_empty(lfsring_seg_t* ring) {
+  return seg_first(ring) == ring->last_seg &&
+         lfs_file_size(ring->backend, &ring->file) == (lfs_soff_t) seg_read_off(ring);
+}
+
+int lfsring_seg_append(lfsring_seg_t* ring, const void* data, lfs_size_t data_size,
+                       enum lfsring_write_mode write_mode) {
+  LFSRING_TRACE("lfsring_seg_append(%p, %p, %u, %d)", (void*) ring, data, data_size, write_mode);
+
+  if (write_mode != LFSRING_NO_OVERWRITE && write_mode != LFSRING_OVERWRITE) {
+    return LFS_ERR_INVAL;
+  }
+
+  if (ring->mode == LFSRING_MODE_FIXED && data_size != ring->record_size) {
+    return LFS_ERR_INVAL;
+  }
+
+  // Objects never span multiple segments.
+  lfs_size_t header_size = seg_header_size(ring);
+  if (ring->segment_size < header_size || data_size > ring->segment_size - header_size) {
+    return LFS_ERR_NOSPC;
+  }
+  lfs_size_t write_size = header_size + data_size;
+
+  lfs_soff_t tail_size = lfs_file_size(ring->backend, &ring->file);
+  if (tail_size < 0) {
+    return tail_size;
+  }
+
+  lfs_size_t old_first = seg_first(ring);
+  if (write_size > ring->segment_size - (lfs_size_t) tail_size) {
+    // Start a new segment. If all segments are in use, the oldest segment must
+    // be discarded as a whole.
+    lfs_size_t first = old_first, read_off = seg_read_off(ring);
+    if (ring->last_seg - first + 1 >= ring->segment_count) {
+      if (write_mode == LFSRING_NO_OVERWRITE) {
+        return LFS_ERR_NOSPC;
+      }
+      first++;
+      read_off = 0;
+    }
+
+    // Closing the current segment commits it as usual. The new segment is only
+    // committed once the object has been written, so a power loss before then
+    // leaves a segment without the attribute, which lfsring_seg_open discards.
+    int err = lfs_file_close(ring->backend, &ring->file);
+    if (err) {
+      // The file is closed even if syncing failed.
+      int reopen_err = seg_open_tail(ring);
+      return reopen_err ? reopen_err : err;
+    }
+
+    ring->last_seg++;
+    err = seg_open_tail(ring);
+    if (err) {
+      ring->last_seg--;
+      int reopen_err = seg_open_tail(ring);
+      return reopen_err ? reopen_err : err;
+    }
+
+    seg_set_read_pos(ring, first, read_off);
+  }
+
+  if (ring->mode == LFSRING_MODE_OBJECT) {
+    lfs_size_t obj_size = lfs_tole32(data_size);
+    lfs_ssize_t written = lfs_file_write(ring->backend, &ring->file, &obj_size, sizeof(obj_size));
+    if (written < 0) {
+      return written;
+    }
+    LFS_ASSERT(written == sizeof(obj_size));
+  }
+
+  lfs_ssize_t written = lfs_file_write(ring->backend, &ring->file, data, data_size);
+  if (written < 0) {
+    return written;
+  }
+  LFS_ASSERT((lfs_size_t) written == data_size);
+
+  return seg_commit(ring, old_first);
+}
+
+lfs_ssize_t lfsring_seg_peek(lfsring_seg_t* ring, void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_seg_peek(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+
+  lfs_file_t* file;
+  lfs_size_t obj_size;
+  int err = seg_read_object_size(ring, &file, &obj_size);
+  if (err) {
+    return err;
+  }
+
+  if (obj_size > buffer_size) {
+    return LFS_ERR_NOMEM;
+  }
+
+  lfs_off_t data_off = seg_read_off(ring) + seg_header_size(ring);
+  lfs_soff_t seeked = lfs_file_seek(ring->backend, file, data_off, LFS_SEEK_SET);
+  if (seeked < 0) {
+    return seeked;
+  }
+
+  lfs_ssize_t n_read = lfs_file_read(ring->backend, file, buffer, obj_size);
+  if (n_read < 0) {
+    return n_read;
+  }
+  if ((lfs_size_t) n_read < obj_size) {
+    return LFS_ERR_CORRUPT;
+  }
+
+  return obj_size;
+}
+
+lfs_ssize_t lfsring_seg_take(lfsring_seg_t* ring, void* buffer, lfs_size_t buffer_size) {
+  LFSRING_TRACE("lfsring_seg_take(%p, %p, %u)", (void*) ring, buffer, buffer_size);
+
+  lfs_ssize_t ret = lfsring_seg_peek(ring, buffer, buffer_size);
+  if (ret < 0) {
+    return ret;
+  }
+
+  lfs_file_t* file;
+  int err = seg_head(ring, &file);
+  if (err) {
+    return err;
+  }
+
+  lfs_size_t old_first = seg_first(ring);
+  err = seg_advance(ring, file, ret);
+  if (err) {
+    return err;
+  }
+
+  err = seg_commit(ring, old_first);
+  if (err) {
+    return err;
+  }
+
+  return ret;
+}
+
+int lfsring_seg_drop(lfsring_seg_t* ring, lfs_size_t n) {
+  LFSRING_TRACE("lfsring_seg_drop(%p, %u)", (void*) ring, n);
+
+  lfs_size_t old_first = seg_first(ring);
+  lfs_off_t old_read_off = seg_read_off(ring);
+
+  for (lfs_size_t i = 0; i < n; i++) {
+    lfs_file_t* file;
+    lfs_size_t obj_size;
+    int err = seg_read_object_size(ring, &file, &obj_size);
+    if (!err) {
+      err = seg_advance(ring, file, obj_size);
+    }
+    if (err) {
+      seg_set_read_pos(ring, old_first, old_read_off);
+      return (err == LFS_ERR_NOENT) ? LFS_ERR_INVAL : err;
+    }
+  }
+
+  return seg_commit(ring, old_first);
+}
+
+int lfsring_seg_close(lfsring_seg_t* ring) {
+  LFSRING_TRACE("lfsring_seg_close(%p)", (void*) ring);
+
+  int err = seg_close_read_file(ring);
+  int close_err = lfs_file_close(ring->backend, &ring->file);
+  return err ? err : close_err;
 }
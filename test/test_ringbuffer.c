@@ -1,8 +1,11 @@
 #include <lfs_ringbuffer.h>
 
+#include <lfs_countbd.h>
 #include <lfs_rambd.h>
 
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
 #define LFS_READ_SIZE      16
 #define LFS_PROG_SIZE      LFS_READ_SIZE
@@ -335,6 +338,2270 @@ static void test_object_mode(lfs_t* fs) {
   assert(err == 0);
 }
 
+static void test_append_batch(lfs_t* fs) {
+  const char* path = "batch.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 256
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  uint8_t data[16][16];
+  lfsring_object_t objects[16];
+  for (unsigned int i = 0; i < 16; i++) {
+    memset(data[i], i, i);
+    objects[i].data = data[i];
+    objects[i].size = i;
+  }
+
+  // An empty batch should have no effect, and should not even be committed.
+  lfs_countbd_t* bd = fs->cfg->context;
+  lfs_countbd_reset(bd);
+  lfs_ssize_t ret = lfsring_append_batch(&rbuf, objects, 0, LFSRING_NO_OVERWRITE);
+  assert(ret == 0);
+  ret = lfsring_append_batch(&rbuf, objects, 0, LFSRING_OVERWRITE);
+  assert(ret == 0);
+  assert(lfsring_is_empty(&rbuf));
+  assert(bd->stats.progs == 0 && bd->stats.syncs == 0);
+
+  // Objects 0 through 11 require 12 * 4 + 66 = 114 bytes, so all of them should
+  // be accepted.
+  ret = lfsring_append_batch(&rbuf, objects, 12, LFSRING_NO_OVERWRITE);
+  assert(ret == 12);
+
+  // Objects 12 through 15 require 4 * 4 + 54 = 70 bytes, and there are 142 bytes
+  // left, so they should be accepted, too. However, only objects 8 through 12
+  // of the next batch fit into the remaining 72 bytes.
+  ret = lfsring_append_batch(&rbuf, objects + 12, 4, LFSRING_NO_OVERWRITE);
+  assert(ret == 4);
+  ret = lfsring_append_batch(&rbuf, objects + 8, 8, LFSRING_NO_OVERWRITE);
+  assert(ret == 5);
+
+  // The remaining space (2 bytes) is too small for the next object.
+  ret = lfsring_append_batch(&rbuf, objects + 12, 4, LFSRING_NO_OVERWRITE);
+  assert(ret == LFS_ERR_NOSPC);
+
+  // The state should persist across reopening the ring buffer.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  uint8_t buffer[16];
+  for (unsigned int i = 0; i < 21; i++) {
+    ret = lfsring_take(&rbuf, buffer, sizeof(buffer));
+    unsigned int expected = (i < 16) ? i : (i - 8);
+    assert(ret >= 0 && (lfs_size_t) ret == expected);
+    for (unsigned int j = 0; j < expected; j++) {
+      assert(buffer[j] == expected);
+    }
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  // With LFSRING_OVERWRITE, all objects should be accepted, even if they do not
+  // fit into the ring buffer at once. Only the most recent objects should be
+  // retained, exactly as if they had been appended one by one.
+  for (unsigned int i = 0; i < 3; i++) {
+    ret = lfsring_append_batch(&rbuf, objects, 16, LFSRING_OVERWRITE);
+    assert(ret == 16);
+  }
+
+  // The last batch requires 184 bytes, which leaves room for objects 12 through
+  // 15 (70 bytes) of the previous batch only.
+  for (unsigned int i = 0; i < 20; i++) {
+    ret = lfsring_take(&rbuf, buffer, sizeof(buffer));
+    unsigned int expected = (i < 4) ? (i + 12) : (i - 4);
+    assert(ret >= 0 && (lfs_size_t) ret == expected);
+    for (unsigned int j = 0; j < expected; j++) {
+      assert(buffer[j] == expected);
+    }
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  // An object that can never fit should cause the entire batch to fail.
+  uint8_t too_large[256];
+  memset(too_large, 0, sizeof(too_large));
+  objects[3].data = too_large;
+  objects[3].size = sizeof(too_large);
+  ret = lfsring_append_batch(&rbuf, objects, 16, LFSRING_OVERWRITE);
+  assert(ret == LFS_ERR_NOSPC);
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // If leading objects of the batch are discarded, older objects must not
+  // survive, even if discarding fewer of them would make room for the rest.
+  uint8_t large[3][32];
+  lfsring_object_t large_objects[3];
+  for (unsigned int i = 0; i < 3; i++) {
+    memset(large[i], 0x20 + i, sizeof(large[i]));
+    large_objects[i].data = large[i];
+  }
+  large_objects[0].size = 27;
+  large_objects[1].size = 23;
+  large_objects[2].size = 29;
+  config.file_size = 45;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, data[15], 15, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, data[2], 2, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  ret = lfsring_append_batch(&rbuf, large_objects, 3, LFSRING_OVERWRITE);
+  assert(ret == 3);
+  assert(lfsring_count(&rbuf) == 1);
+  uint8_t large_buffer[32];
+  ret = lfsring_take(&rbuf, large_buffer, sizeof(large_buffer));
+  assert(ret == 29);
+  assert(memcmp(large_buffer, large[2], 29) == 0);
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+// Returns the distance between the read and the write position as it has been
+// committed to the file system.
+static lfs_size_t get_committed_write_dist(lfs_t* fs, const char* path) {
+  uint8_t attr[36];
+  lfs_ssize_t ret = lfs_getattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  if (ret == LFS_ERR_NOATTR) {
+    return 0;
+  }
+  assert(ret == sizeof(attr));
+  lfs_size_t write_dist;
+  memcpy(&write_dist, attr + 8, sizeof(write_dist));
+  return lfs_fromle32(write_dist);
+}
+
+static void test_sync_policy(lfs_t* fs) {
+  const char* path = "sync.cb";
+  const char* msg = "Hello world";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_STREAM,
+    .file_size = 1024,
+    .sync_policy = LFSRING_SYNC_MANUAL
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Nothing should be committed until the ring buffer is flushed.
+  for (unsigned int i = 0; i < 10; i++) {
+    err = lfsring_append(&rbuf, msg, strlen(msg), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+    assert(get_committed_write_dist(fs, path) == 0);
+  }
+
+  err = lfsring_flush(&rbuf);
+  assert(err == 0);
+  assert(get_committed_write_dist(fs, path) == 10 * strlen(msg));
+
+  // Flushing again should have no effect.
+  err = lfsring_flush(&rbuf);
+  assert(err == 0);
+
+  // Closing the ring buffer should commit pending changes, too.
+  err = lfsring_drop(&rbuf, strlen(msg));
+  assert(err == 0);
+  assert(get_committed_write_dist(fs, path) == 10 * strlen(msg));
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  assert(get_committed_write_dist(fs, path) == 9 * strlen(msg));
+
+  // Commit after every third operation.
+  config.sync_policy = LFSRING_SYNC_OPS;
+  config.sync_threshold = 3;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  for (unsigned int i = 1; i <= 9; i++) {
+    err = lfsring_append(&rbuf, msg, strlen(msg), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+    lfs_size_t n_committed = 9 + (i / 3) * 3;
+    assert(get_committed_write_dist(fs, path) == n_committed * strlen(msg));
+  }
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Commit once the positions have moved by at least 32 bytes.
+  config.sync_policy = LFSRING_SYNC_BYTES;
+  config.sync_threshold = 32;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  lfs_size_t n_committed = 18 * strlen(msg);
+  for (unsigned int i = 1; i <= 9; i++) {
+    err = lfsring_append(&rbuf, msg, strlen(msg), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+    if (i % 3 == 0) {
+      n_committed += 3 * strlen(msg);
+    }
+    assert(get_committed_write_dist(fs, path) == n_committed);
+  }
+
+  // The state should not depend on whether changes have been committed.
+  assert(n_committed == 27 * strlen(msg));
+  uint8_t buffer[16];
+  for (unsigned int i = 0; i < 27; i++) {
+    lfs_ssize_t ret = lfsring_take(&rbuf, buffer, strlen(msg));
+    assert(ret == (lfs_ssize_t) strlen(msg));
+    assert(memcmp(buffer, msg, strlen(msg)) == 0);
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  assert(get_committed_write_dist(fs, path) == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_take_many(lfs_t* fs) {
+  const char* path = "many.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 512
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  uint8_t buffer[64];
+  lfs_size_t sizes[8];
+
+  lfs_ssize_t ret = lfsring_take_many(&rbuf, buffer, sizeof(buffer), sizes, 8);
+  assert(ret == LFS_ERR_NOENT);
+
+  // Append objects of sizes 0, 1, ..., 19, wrapping around the end of the file.
+  for (unsigned int i = 0; i < 4; i++) {
+    err = lfsring_append(&rbuf, buffer, sizeof(buffer), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  err = lfsring_drop(&rbuf, 4);
+  assert(err == 0);
+  for (unsigned int i = 0; i < 20; i++) {
+    memset(buffer, i, i);
+    err = lfsring_append(&rbuf, buffer, i, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+
+  // Retrieving no objects at all should not even be committed.
+  lfs_countbd_t* bd = fs->cfg->context;
+  lfs_countbd_reset(bd);
+  ret = lfsring_take_many(&rbuf, buffer, sizeof(buffer), sizes, 0);
+  assert(ret == 0);
+  assert(lfsring_count(&rbuf) == 20);
+  assert(bd->stats.progs == 0 && bd->stats.syncs == 0);
+
+  // The number of objects should be limited by max_objects.
+  memset(buffer, 0xff, sizeof(buffer));
+  ret = lfsring_take_many(&rbuf, buffer, sizeof(buffer), sizes, 4);
+  assert(ret == 4);
+  for (unsigned int i = 0; i < 4; i++) {
+    assert(sizes[i] == i);
+  }
+  assert(memcmp(buffer, "\x01\x02\x02\x03\x03\x03\xff", 7) == 0);
+
+  // The number of objects should be limited by the size of the buffer.
+  unsigned int next = 4;
+  while (next < 20) {
+    memset(buffer, 0xff, sizeof(buffer));
+    ret = lfsring_take_many(&rbuf, buffer, sizeof(buffer), sizes, 8);
+    assert(ret > 0 && ret <= 8);
+
+    lfs_size_t used = 0;
+    for (lfs_ssize_t i = 0; i < ret; i++) {
+      assert(sizes[i] == next);
+      for (lfs_size_t j = 0; j < sizes[i]; j++) {
+        assert(buffer[used + j] == next);
+      }
+      used += sizes[i];
+      next++;
+    }
+    assert(ret == 8 || next == 20 || used + next > sizeof(buffer));
+  }
+
+  assert(lfsring_is_empty(&rbuf));
+
+  // If not even the first object fits, no object should be removed.
+  err = lfsring_append(&rbuf, buffer, 10, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  ret = lfsring_take_many(&rbuf, buffer, 9, sizes, 8);
+  assert(ret == LFS_ERR_NOMEM);
+  assert(!lfsring_is_empty(&rbuf));
+  ret = lfsring_take_many(&rbuf, buffer, 10, sizes, 8);
+  assert(ret == 1 && sizes[0] == 10);
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+struct visit_state {
+  uint8_t data[256];
+  lfs_size_t size;
+  unsigned int n_chunks;
+  unsigned int n_objects;
+  unsigned int stop_after;
+};
+
+static int visit_cb(void* ctx, const lfsring_chunk_t* chunk) {
+  struct visit_state* state = ctx;
+
+  assert(chunk->size <= 7);
+  assert(chunk->offset + chunk->size <= chunk->total_size);
+  if (chunk->offset == 0) {
+    state->size = 0;
+  }
+  assert(chunk->offset == state->size);
+  memcpy(state->data + state->size, chunk->data, chunk->size);
+  state->size += chunk->size;
+  state->n_chunks++;
+  if (state->size == chunk->total_size) {
+    state->n_objects++;
+  }
+
+  return (state->n_chunks == state->stop_after) ? 1 : 0;
+}
+
+static int visit_error_cb(void* ctx, const lfsring_chunk_t* chunk) {
+  (void) ctx;
+  (void) chunk;
+  return LFS_ERR_IO;
+}
+
+static void test_visit(lfs_t* fs) {
+  const char* path = "visit.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 128
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  uint8_t chunk_buffer[7];
+  struct visit_state state;
+  memset(&state, 0, sizeof(state));
+
+  lfs_ssize_t ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 1000, visit_cb, &state);
+  assert(ret == 0 && state.n_chunks == 0);
+
+  // Add objects of increasing size, some of which wrap around the end of the
+  // file.
+  uint8_t obj[40];
+  for (unsigned int i = 0; i < 20; i++) {
+    memset(obj, i, i * 2);
+    err = lfsring_append(&rbuf, obj, i * 2, LFSRING_OVERWRITE);
+    assert(err == 0);
+
+    // Visiting the first object should produce the same result as peek.
+    memset(&state, 0, sizeof(state));
+    state.stop_after = (unsigned int) -1;
+    ret = lfsring_peek(&rbuf, obj, sizeof(obj));
+    assert(ret >= 0);
+    lfs_size_t obj_size = ret;
+    ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), obj_size, visit_cb, &state);
+    assert(ret == 1);
+    assert(state.n_objects == 1);
+    assert(state.n_chunks >= (obj_size + sizeof(chunk_buffer) - 1) / sizeof(chunk_buffer));
+    assert(state.size == obj_size && memcmp(state.data, obj, obj_size) == 0);
+
+    // Visiting all objects should not remove any of them.
+    memset(&state, 0, sizeof(state));
+    state.stop_after = (unsigned int) -1;
+    ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 1000, visit_cb, &state);
+    assert(ret > 0 && (unsigned int) ret == state.n_objects);
+    assert(state.size == i * 2);
+    for (unsigned int j = 0; j < i * 2; j++) {
+      assert(state.data[j] == i);
+    }
+  }
+
+  // Stopping after the first chunk of a multi-chunk object should not count the
+  // object as visited.
+  memset(&state, 0, sizeof(state));
+  ret = lfsring_peek(&rbuf, obj, sizeof(obj));
+  assert(ret > (lfs_ssize_t) sizeof(chunk_buffer));
+  state.stop_after = 1;
+  ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 1000, visit_cb, &state);
+  assert(ret == 0);
+
+  // Errors returned by the callback should be passed through.
+  ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 1000, visit_error_cb, NULL);
+  assert(ret == LFS_ERR_IO);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // In stream mode, the return value is the number of bytes.
+  config.mode = LFSRING_MODE_STREAM;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  for (unsigned int i = 0; i < 3 * config.file_size; i += sizeof(obj)) {
+    for (unsigned int j = 0; j < sizeof(obj); j++) {
+      obj[j] = (uint8_t) (i + j);
+    }
+    err = lfsring_append(&rbuf, obj, sizeof(obj), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+
+  memset(&state, 0, sizeof(state));
+  state.stop_after = (unsigned int) -1;
+  ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 100, visit_cb, &state);
+  assert(ret == 100 && state.size == 100 && state.n_objects == 1);
+  for (unsigned int j = 1; j < 100; j++) {
+    assert(state.data[j] == (uint8_t) (state.data[j - 1] + 1));
+  }
+
+  memset(&state, 0, sizeof(state));
+  state.stop_after = 2;
+  ret = lfsring_visit(&rbuf, chunk_buffer, sizeof(chunk_buffer), 100, visit_cb, &state);
+  assert(ret > 0 && (lfs_size_t) ret == state.size && state.n_chunks == 2);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_cursor(lfs_t* fs) {
+  const char* path = "cursor.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 256
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  lfsring_cursor_t cursor;
+  err = lfsring_cursor_init(&rbuf, &cursor);
+  assert(err == 0);
+  lfs_ssize_t ret = lfsring_cursor_size(&rbuf, &cursor);
+  assert(ret == LFS_ERR_NOENT);
+
+  uint8_t buffer[32];
+  for (unsigned int i = 0; i < 10; i++) {
+    memset(buffer, i, i);
+    err = lfsring_append(&rbuf, buffer, i, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+
+  // Objects that were appended after initializing the cursor should be visible.
+  for (unsigned int i = 0; i < 10; i++) {
+    ret = lfsring_cursor_size(&rbuf, &cursor);
+    assert(ret >= 0 && (lfs_size_t) ret == i);
+    ret = lfsring_cursor_peek(&rbuf, &cursor, buffer, sizeof(buffer));
+    assert(ret >= 0 && (lfs_size_t) ret == i);
+    for (unsigned int j = 0; j < i; j++) {
+      assert(buffer[j] == i);
+    }
+    if (i != 0) {
+      ret = lfsring_cursor_peek(&rbuf, &cursor, buffer, i - 1);
+      assert(ret == LFS_ERR_NOMEM);
+    }
+    err = lfsring_cursor_next(&rbuf, &cursor);
+    assert(err == 0);
+  }
+  err = lfsring_cursor_next(&rbuf, &cursor);
+  assert(err == LFS_ERR_NOENT);
+
+  // Iterating should not have removed anything.
+  ret = lfsring_peek(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 0);
+
+  // Remove the first five objects using a cursor.
+  err = lfsring_cursor_init(&rbuf, &cursor);
+  assert(err == 0);
+  for (unsigned int i = 0; i < 5; i++) {
+    err = lfsring_cursor_next(&rbuf, &cursor);
+    assert(err == 0);
+  }
+  err = lfsring_cursor_drop(&rbuf, &cursor);
+  assert(err == 0);
+  ret = lfsring_peek(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 5);
+  ret = lfsring_cursor_size(&rbuf, &cursor);
+  assert(ret == 5);
+
+  // Once the object that the cursor points to is gone, the cursor is invalid.
+  err = lfsring_drop(&rbuf, 1);
+  assert(err == 0);
+  ret = lfsring_cursor_peek(&rbuf, &cursor, buffer, sizeof(buffer));
+  assert(ret == LFS_ERR_INVAL);
+  err = lfsring_cursor_drop(&rbuf, &cursor);
+  assert(err == LFS_ERR_INVAL);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_index(lfs_t* fs) {
+  const char* paths[2] = { "indexed.cb", "unindexed.cb" };
+
+  lfs_off_t index[5];
+  lfsring_config_t configs[2] = {
+    {
+      .attr_metadata = LFSRING_DEFAULT_ATTR,
+      .mode = LFSRING_MODE_OBJECT,
+      .file_size = 1024,
+      .index_buffer = index,
+      .index_size = sizeof(index) / sizeof(index[0]),
+      .index_interval = 2
+    },
+    {
+      .attr_metadata = LFSRING_DEFAULT_ATTR,
+      .mode = LFSRING_MODE_OBJECT,
+      .file_size = 1024
+    }
+  };
+
+  lfsring_t rbufs[2];
+  for (unsigned int i = 0; i < 2; i++) {
+    int err = lfsring_open(&rbufs[i], fs, paths[i], &configs[i]);
+    assert(err == 0);
+  }
+
+  // Perform the same pseudo-random operations on both ring buffers, which should
+  // produce the same results regardless of the index.
+  uint32_t rand_state = 12345;
+  uint8_t buffer[2][64];
+  for (unsigned int step = 0; step < 2000; step++) {
+    rand_state = rand_state * 1103515245 + 12345;
+    unsigned int r = (rand_state >> 16) & 0x7fff;
+    unsigned int op = r % 8;
+    lfs_size_t obj_size = (r / 8) % sizeof(buffer[0]);
+    lfs_size_t n = (r / 8) % 40;
+
+    int results[2];
+    lfsring_cursor_t cursors[2];
+    for (unsigned int i = 0; i < 2; i++) {
+      if (op < 4) {
+        memset(buffer[i], step, obj_size);
+        results[i] = lfsring_append(&rbufs[i], buffer[i], obj_size, LFSRING_OVERWRITE);
+      } else if (op == 4) {
+        results[i] = lfsring_drop(&rbufs[i], n);
+      } else if (op == 5) {
+        results[i] = lfsring_cursor_init(&rbufs[i], &cursors[i]);
+        assert(results[i] == 0);
+        results[i] = lfsring_cursor_seek(&rbufs[i], &cursors[i], n);
+        if (results[i] == 0) {
+          results[i] = lfsring_cursor_peek(&rbufs[i], &cursors[i], buffer[i], sizeof(buffer[i]));
+        }
+      } else if (op == 6) {
+        results[i] = lfsring_take(&rbufs[i], buffer[i], sizeof(buffer[i]));
+      } else if (step % 5 == 0) {
+        // The index should be rebuilt after reopening the ring buffer.
+        results[i] = lfsring_close(&rbufs[i]);
+        assert(results[i] == 0);
+        results[i] = lfsring_open(&rbufs[i], fs, paths[i], &configs[i]);
+      } else {
+        results[i] = lfsring_peek(&rbufs[i], buffer[i], sizeof(buffer[i]));
+      }
+    }
+
+    assert(results[0] == results[1]);
+    if (op >= 5 && results[0] > 0) {
+      assert(memcmp(buffer[0], buffer[1], results[0]) == 0);
+    }
+  }
+
+  for (unsigned int i = 0; i < 2; i++) {
+    int err = lfsring_close(&rbufs[i]);
+    assert(err == 0);
+    err = lfs_remove(fs, paths[i]);
+    assert(err == 0);
+  }
+}
+
+static void test_fixed_mode(lfs_t* fs) {
+  const char* path = "fixed.cb";
+
+  struct record {
+    uint32_t seq;
+    uint8_t payload[12];
+  };
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_FIXED,
+    .record_size = sizeof(struct record),
+    .file_size = 1000
+  };
+
+  // Records must not be empty.
+  lfsring_t rbuf;
+  config.record_size = 0;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.record_size = sizeof(struct record);
+
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  struct record rec;
+  lfs_ssize_t ret = lfsring_peek(&rbuf, &rec, sizeof(rec));
+  assert(ret == LFS_ERR_NOENT);
+
+  // Only records of the configured size can be appended.
+  err = lfsring_append(&rbuf, &rec, sizeof(rec) - 1, LFSRING_NO_OVERWRITE);
+  assert(err == LFS_ERR_INVAL);
+
+  // Records are not preceded by a header, so exactly 62 records fit into the
+  // ring buffer.
+  uint32_t next_seq = 0;
+  for (unsigned int i = 0; i < config.file_size / sizeof(rec); i++) {
+    rec.seq = next_seq++;
+    memset(rec.payload, rec.seq, sizeof(rec.payload));
+    err = lfsring_append(&rbuf, &rec, sizeof(rec), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  err = lfsring_append(&rbuf, &rec, sizeof(rec), LFSRING_NO_OVERWRITE);
+  assert(err == LFS_ERR_NOSPC);
+
+  // Dropping more records than available should fail.
+  err = lfsring_drop(&rbuf, config.file_size / sizeof(rec) + 1);
+  assert(err == LFS_ERR_INVAL);
+
+  err = lfsring_drop(&rbuf, 10);
+  assert(err == 0);
+  ret = lfsring_peek(&rbuf, &rec, sizeof(rec) - 1);
+  assert(ret == LFS_ERR_NOMEM);
+  ret = lfsring_take(&rbuf, &rec, sizeof(rec));
+  assert(ret == sizeof(rec) && rec.seq == 10);
+
+  // Overwriting should discard as few records as possible, even though the
+  // file size is not a multiple of the record size and records wrap around the
+  // end of the file.
+  uint32_t first_seq = 11;
+  for (unsigned int i = 0; i < 500; i++) {
+    rec.seq = next_seq++;
+    memset(rec.payload, rec.seq, sizeof(rec.payload));
+    err = lfsring_append(&rbuf, &rec, sizeof(rec), LFSRING_OVERWRITE);
+    assert(err == 0);
+
+    if (next_seq - first_seq > config.file_size / sizeof(rec)) {
+      first_seq++;
+    }
+
+    if (i % 50 == 0) {
+      err = lfsring_close(&rbuf);
+      assert(err == 0);
+      err = lfsring_open(&rbuf, fs, path, &config);
+      assert(err == 0);
+    }
+
+    ret = lfsring_peek(&rbuf, &rec, sizeof(rec));
+    assert(ret == sizeof(rec) && rec.seq == first_seq);
+  }
+
+  // Seeking a cursor should not require walking records.
+  lfsring_cursor_t cursor;
+  err = lfsring_cursor_init(&rbuf, &cursor);
+  assert(err == 0);
+  err = lfsring_cursor_seek(&rbuf, &cursor, 42);
+  assert(err == 0);
+  ret = lfsring_cursor_peek(&rbuf, &cursor, &rec, sizeof(rec));
+  assert(ret == sizeof(rec) && rec.seq == first_seq + 42);
+  for (unsigned int i = 0; i < sizeof(rec.payload); i++) {
+    assert(rec.payload[i] == (uint8_t) rec.seq);
+  }
+
+  // All records should be intact.
+  while (!lfsring_is_empty(&rbuf)) {
+    ret = lfsring_take(&rbuf, &rec, sizeof(rec));
+    assert(ret == sizeof(rec) && rec.seq == first_seq++);
+  }
+  assert(first_seq == next_seq);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // Records that are smaller than an object header must not overwrite other
+  // records when the ring buffer is full.
+  config.record_size = 2;
+  config.file_size = 10;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  for (uint8_t i = 0; i < 5; i++) {
+    uint8_t small[2] = { i, i };
+    err = lfsring_append(&rbuf, small, sizeof(small), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  for (uint8_t i = 0; i < 5; i++) {
+    uint8_t small[2];
+    ret = lfsring_take(&rbuf, small, sizeof(small));
+    assert(ret == sizeof(small) && small[0] == i && small[1] == i);
+  }
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // The same applies to elastic ring buffers, whose capacity can be smaller
+  // than an object header.
+  config.elastic = true;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  for (uint8_t i = 0; i < 7; i++) {
+    uint8_t small[2] = { i, i };
+    err = lfsring_append(&rbuf, small, sizeof(small), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  for (uint8_t i = 2; i < 7; i++) {
+    uint8_t small[2];
+    ret = lfsring_take(&rbuf, small, sizeof(small));
+    assert(ret == sizeof(small) && small[0] == i && small[1] == i);
+  }
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static lfs_size_t count_segments(lfs_t* fs, const char* path) {
+  lfs_dir_t dir;
+  int err = lfs_dir_open(fs, &dir, path);
+  assert(err == 0);
+
+  lfs_size_t n = 0;
+  struct lfs_info info;
+  while ((err = lfs_dir_read(fs, &dir, &info)) > 0) {
+    if (info.type == LFS_TYPE_REG) {
+      n++;
+    }
+  }
+  assert(err == 0);
+
+  err = lfs_dir_close(fs, &dir);
+  assert(err == 0);
+  return n;
+}
+
+static void test_segmented(lfs_t* fs) {
+  const char* path = "segmented";
+
+  lfsring_seg_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .segment_size = 100,
+    .segment_count = 4
+  };
+
+  // Stream mode is not supported.
+  lfsring_seg_t rbuf;
+  config.mode = LFSRING_MODE_STREAM;
+  int err = lfsring_seg_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.mode = LFSRING_MODE_OBJECT;
+
+  err = lfsring_seg_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(lfsring_seg_is_empty(&rbuf));
+  assert(count_segments(fs, path) == 1);
+
+  uint8_t buffer[100];
+  lfs_ssize_t ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == LFS_ERR_NOENT);
+
+  // Objects must fit into a single segment.
+  err = lfsring_seg_append(&rbuf, buffer, 97, LFSRING_OVERWRITE);
+  assert(err == LFS_ERR_NOSPC);
+
+  // Each segment has room for two objects of 40 bytes. Once all segments are in
+  // use, appending more objects fails unless overwriting is allowed.
+  uint8_t next = 0;
+  for (unsigned int i = 0; i < 8; i++) {
+    memset(buffer, next++, 40);
+    err = lfsring_seg_append(&rbuf, buffer, 40, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  assert(count_segments(fs, path) == 4);
+  err = lfsring_seg_append(&rbuf, buffer, 40, LFSRING_NO_OVERWRITE);
+  assert(err == LFS_ERR_NOSPC);
+
+  // Small objects still fit into the newest segment.
+  err = lfsring_seg_append(&rbuf, buffer, 8, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+
+  // Overwriting discards the oldest segment as a whole.
+  memset(buffer, next++, 40);
+  err = lfsring_seg_append(&rbuf, buffer, 40, LFSRING_OVERWRITE);
+  assert(err == 0);
+  assert(count_segments(fs, path) == 4);
+
+  // The state should survive reopening the ring buffer.
+  err = lfsring_seg_close(&rbuf);
+  assert(err == 0);
+  err = lfsring_seg_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  uint8_t expected = 2;
+  for (unsigned int i = 0; i < 3; i++) {
+    ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+    assert(ret == 40 && buffer[0] == expected && buffer[39] == expected);
+    expected++;
+  }
+
+  // Consumed segments are removed.
+  assert(count_segments(fs, path) == 3);
+
+  ret = lfsring_seg_peek(&rbuf, buffer, 39);
+  assert(ret == LFS_ERR_NOMEM);
+
+  // Dropping more objects than available should fail without side effects.
+  err = lfsring_seg_drop(&rbuf, 100);
+  assert(err == LFS_ERR_INVAL);
+  ret = lfsring_seg_peek(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 40 && buffer[0] == expected);
+
+  err = lfsring_seg_drop(&rbuf, 3);
+  assert(err == 0);
+  expected += 3;
+  ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 8 && buffer[0] == 7);
+  ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 40 && buffer[0] == 8);
+
+  // Emptying the ring buffer truncates the remaining segment.
+  assert(lfsring_seg_is_empty(&rbuf));
+  assert(count_segments(fs, path) == 1);
+  ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == LFS_ERR_NOENT);
+
+  // Simulate a power loss after creating a new segment, but before the first
+  // commit of that segment. Such segments must be discarded.
+  for (unsigned int i = 0; i < 3; i++) {
+    memset(buffer, next++, 40);
+    err = lfsring_seg_append(&rbuf, buffer, 40, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  err = lfsring_seg_close(&rbuf);
+  assert(err == 0);
+  assert(count_segments(fs, path) == 2);
+
+  char seg_path[32];
+  lfs_file_t file;
+  snprintf(seg_path, sizeof(seg_path), "%s/%08x", path, (unsigned int) rbuf.last_seg + 1);
+  err = lfs_file_open(fs, &file, seg_path, LFS_O_CREAT | LFS_O_WRONLY);
+  assert(err == 0);
+  err = lfs_file_close(fs, &file);
+  assert(err == 0);
+
+  err = lfsring_seg_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(count_segments(fs, path) == 2);
+
+  expected = next - 3;
+  while (!lfsring_seg_is_empty(&rbuf)) {
+    ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+    assert(ret == 40 && buffer[0] == expected++);
+  }
+  assert(expected == next);
+
+  err = lfsring_seg_close(&rbuf);
+  assert(err == 0);
+
+  // Fixed-size records are supported, too. A single segment behaves like a
+  // ring buffer that discards all data when it is full.
+  config.mode = LFSRING_MODE_FIXED;
+  config.record_size = 30;
+  config.segment_count = 1;
+  err = lfsring_seg_open(&rbuf, fs, "segmented-fixed", &config);
+  assert(err == 0);
+  for (unsigned int i = 0; i < 7; i++) {
+    memset(buffer, i, 30);
+    err = lfsring_seg_append(&rbuf, buffer, 30, LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  ret = lfsring_seg_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == 30 && buffer[0] == 6);
+  assert(lfsring_seg_is_empty(&rbuf));
+  err = lfsring_seg_close(&rbuf);
+  assert(err == 0);
+}
+
+static void test_io_budget(lfs_t* fs) {
+  const char* path = "budget.cb";
+
+  // The test harness inserts a counting block device.
+  lfs_countbd_t* bd = fs->cfg->context;
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 4 * 1024
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Each append should be committed at least once, but should not require more
+  // than two block device syncs on average, even when overwriting objects.
+  uint8_t data[32];
+  memset(data, 0x42, sizeof(data));
+  lfs_countbd_reset(bd);
+  for (unsigned int i = 0; i < 200; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  assert(bd->stats.syncs >= 200 && bd->stats.syncs <= 2 * 200);
+  assert(bd->stats.prog_bytes >= 200 * sizeof(data));
+
+  // Reading should not modify the block device.
+  lfs_countbd_reset(bd);
+  lfs_ssize_t ret = lfsring_peek(&rbuf, data, sizeof(data));
+  assert(ret == sizeof(data));
+  assert(bd->stats.progs == 0 && bd->stats.erases == 0 && bd->stats.syncs == 0);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Deferred commits should not sync the block device at all.
+  config.sync_policy = LFSRING_SYNC_MANUAL;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  lfs_countbd_reset(bd);
+  for (unsigned int i = 0; i < 10; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  assert(bd->stats.syncs == 0);
+
+  err = lfsring_flush(&rbuf);
+  assert(err == 0);
+  assert(bd->stats.syncs >= 1);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_count(lfs_t* fs) {
+  const char* path = "count.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 100
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 0);
+  assert(lfsring_used_bytes(&rbuf) == 0);
+  assert(lfsring_free_bytes(&rbuf) == 100);
+
+  // Each object occupies 14 bytes, so seven objects fit into the file.
+  uint8_t data[10] = { 0 };
+  for (unsigned int i = 0; i < 9; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+    assert(lfsring_count(&rbuf) == (lfs_ssize_t) lfs_min(i + 1, 7));
+  }
+  assert(lfsring_used_bytes(&rbuf) == 98);
+  assert(lfsring_free_bytes(&rbuf) == 2);
+
+  lfs_ssize_t ret = lfsring_take(&rbuf, data, sizeof(data));
+  assert(ret == sizeof(data));
+  err = lfsring_drop(&rbuf, 2);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 4);
+
+  lfsring_object_t objects[2] = { { data, 5 }, { data, 0 } };
+  ret = lfsring_append_batch(&rbuf, objects, 2, LFSRING_NO_OVERWRITE);
+  assert(ret == 2);
+  assert(lfsring_count(&rbuf) == 6);
+  assert(lfsring_used_bytes(&rbuf) == 4 * 14 + 9 + 4);
+
+  // The number of objects is persisted.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 6);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Older versions stored only the first 12 bytes of the attribute, in which
+  // case the objects are counted when the ring buffer is opened.
+  uint8_t attr[36];
+  lfs_ssize_t attr_size = lfs_getattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  assert(attr_size == sizeof(attr));
+  err = lfs_setattr(fs, path, LFSRING_DEFAULT_ATTR, attr, 12);
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 6);
+  err = lfsring_drop(&rbuf, 6);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 0);
+  assert(lfsring_is_empty(&rbuf));
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // Stream mode does not have objects.
+  config.mode = LFSRING_MODE_STREAM;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == LFS_ERR_INVAL);
+  assert(lfsring_used_bytes(&rbuf) == sizeof(data));
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_header(lfs_t* fs) {
+  const char* path = "header.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_FIXED,
+    .record_size = 8,
+    .file_size = 100
+  };
+
+  // Without a file size, a ring buffer is not created.
+  lfsring_config_t unknown_config = { .attr_metadata = LFSRING_DEFAULT_ATTR };
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == LFS_ERR_NOENT);
+
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // The geometry and mode must match.
+  config.file_size = 200;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.file_size = 100;
+  config.record_size = 4;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.record_size = 8;
+  config.mode = LFSRING_MODE_OBJECT;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+
+  // Without a file size, the stored configuration is used.
+  err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == 0);
+  assert(rbuf.mode == LFSRING_MODE_FIXED);
+  assert(rbuf.file_size == 100);
+  assert(lfsring_count(&rbuf) == 1);
+  uint8_t buffer[8];
+  lfs_ssize_t ret = lfsring_peek(&rbuf, buffer, sizeof(buffer));
+  assert(ret == sizeof(buffer));
+  assert(memcmp(buffer, data, sizeof(data)) == 0);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Read-only ring buffers can be inspected, but never modify the file.
+  lfs_countbd_t* bd = fs->cfg->context;
+  lfs_countbd_reset(bd);
+  unknown_config.read_only = true;
+  err = lfsring_open(&rbuf, fs, "missing.cb", &unknown_config);
+  assert(err == LFS_ERR_NOENT);
+  err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == 0);
+  ret = lfsring_peek(&rbuf, buffer, sizeof(buffer));
+  assert(ret == sizeof(buffer));
+  err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+  assert(err == LFS_ERR_INVAL);
+  ret = lfsring_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == LFS_ERR_INVAL);
+  err = lfsring_drop(&rbuf, 1);
+  assert(err == LFS_ERR_INVAL);
+  err = lfsring_resize(&rbuf, 200);
+  assert(err == LFS_ERR_INVAL);
+  assert(lfsring_count(&rbuf) == 1);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  assert(bd->stats.progs == 0 && bd->stats.erases == 0);
+  unknown_config.read_only = false;
+
+  // Unknown format versions and flags are rejected.
+  uint8_t attr[36];
+  lfs_ssize_t attr_size = lfs_getattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  assert(attr_size == sizeof(attr));
+  assert(attr[16] == LFSRING_FORMAT_VERSION);
+  attr[16] = LFSRING_FORMAT_VERSION + 1;
+  err = lfs_setattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == LFS_ERR_INVAL);
+  attr[16] = LFSRING_FORMAT_VERSION;
+  attr[18] = 0x80;
+  err = lfs_setattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == LFS_ERR_INVAL);
+
+  // A write position beyond the end of the file indicates corruption.
+  attr[18] = 0;
+  attr[8] = 101;
+  err = lfs_setattr(fs, path, LFSRING_DEFAULT_ATTR, attr, sizeof(attr));
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &unknown_config);
+  assert(err == LFS_ERR_CORRUPT);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+// Takes all objects from the ring buffer and checks that they are the objects
+// first, ..., end - 1 as appended by test_resize.
+static void take_resize_objects(lfsring_t* rbuf, unsigned int first, unsigned int end) {
+  assert(lfsring_count(rbuf) == (lfs_ssize_t) (end - first));
+  for (unsigned int i = first; i < end; i++) {
+    uint8_t buffer[10];
+    lfs_ssize_t ret = lfsring_take(rbuf, buffer, sizeof(buffer));
+    assert(ret == sizeof(buffer));
+    for (unsigned int j = 0; j < sizeof(buffer); j++) {
+      assert(buffer[j] == (uint8_t) (i + j));
+    }
+  }
+  assert(lfsring_is_empty(rbuf));
+}
+
+static void append_resize_objects(lfsring_t* rbuf, unsigned int first, unsigned int end) {
+  for (unsigned int i = first; i < end; i++) {
+    uint8_t data[10];
+    for (unsigned int j = 0; j < sizeof(data); j++) {
+      data[j] = (uint8_t) (i + j);
+    }
+    int err = lfsring_append(rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+}
+
+static void test_resize(lfs_t* fs) {
+  const char* path = "resize.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 100
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  err = lfsring_resize(&rbuf, 0);
+  assert(err == LFS_ERR_INVAL);
+
+  // Each object occupies 14 bytes, so only objects 3 to 9 remain, and they
+  // wrap around the end of the file.
+  append_resize_objects(&rbuf, 0, 10);
+  err = lfsring_resize(&rbuf, 300);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 7);
+  assert(lfsring_free_bytes(&rbuf) == 300 - 7 * 14);
+
+  // Growing did not discard any objects, and the new space is usable.
+  append_resize_objects(&rbuf, 10, 20);
+  assert(lfsring_count(&rbuf) == 17);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // The new size has been committed.
+  config.file_size = 0;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(rbuf.file_size == 300);
+
+  // Shrinking discards the oldest objects and truncates the file.
+  err = lfsring_resize(&rbuf, 50);
+  assert(err == 0);
+  struct lfs_info info;
+  err = lfs_stat(fs, path, &info);
+  assert(err == 0);
+  assert(info.size <= 50);
+  take_resize_objects(&rbuf, 17, 20);
+
+  // Shrinking a ring buffer whose data wraps around the end of the file.
+  err = lfsring_resize(&rbuf, 100);
+  assert(err == 0);
+  append_resize_objects(&rbuf, 0, 10);
+  err = lfsring_resize(&rbuf, 90);
+  assert(err == 0);
+  take_resize_objects(&rbuf, 4, 10);
+
+  // Shrinking without discarding data moves data that does not fit.
+  append_resize_objects(&rbuf, 0, 3);
+  err = lfsring_resize(&rbuf, 50);
+  assert(err == 0);
+  take_resize_objects(&rbuf, 0, 3);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // In stream mode, individual bytes are discarded.
+  config.mode = LFSRING_MODE_STREAM;
+  config.file_size = 100;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  uint8_t data[160];
+  for (unsigned int i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t) i;
+  }
+  err = lfsring_append(&rbuf, data, 70, LFSRING_OVERWRITE);
+  assert(err == 0);
+  lfs_ssize_t ret = lfsring_take(&rbuf, data, 50);
+  assert(ret == 50);
+  for (unsigned int i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t) i;
+  }
+  err = lfsring_append(&rbuf, data + 70, 60, LFSRING_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_resize(&rbuf, 80);
+  assert(err == 0);
+  assert(lfsring_used_bytes(&rbuf) == 80);
+  uint8_t buffer[80];
+  ret = lfsring_take(&rbuf, buffer, sizeof(buffer));
+  assert(ret == sizeof(buffer));
+  assert(memcmp(buffer, data + 50, sizeof(buffer)) == 0);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static lfs_size_t get_file_size(lfs_t* fs, const char* path) {
+  struct lfs_info info;
+  int err = lfs_stat(fs, path, &info);
+  assert(err == 0);
+  return info.size;
+}
+
+static void test_elastic(lfs_t* fs) {
+  const char* path = "elastic.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 1000,
+    .elastic = true
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(lfsring_free_bytes(&rbuf) == 1000);
+
+  // The capacity doubles as objects are appended, from 14 to 112 bytes.
+  append_resize_objects(&rbuf, 0, 5);
+  assert(rbuf.capacity == 112);
+  assert(get_file_size(fs, path) == 5 * 14);
+
+  // Objects wrap around the end of the file before the capacity grows again,
+  // which requires moving the wrapped objects.
+  err = lfsring_drop(&rbuf, 4);
+  assert(err == 0);
+  append_resize_objects(&rbuf, 5, 12);
+  assert(rbuf.capacity == 112);
+  lfsring_cursor_t cursor;
+  err = lfsring_cursor_init(&rbuf, &cursor);
+  assert(err == 0);
+  err = lfsring_cursor_next(&rbuf, &cursor);
+  assert(err == 0);
+  lfs_off_t read_low = rbuf.attr_buf.le.read_low;
+  append_resize_objects(&rbuf, 12, 13);
+  assert(rbuf.capacity == 224);
+
+  // Moving the data does not change the absolute positions, so cursors remain
+  // valid.
+  assert(rbuf.attr_buf.le.read_low == read_low);
+  uint8_t object[10];
+  lfs_ssize_t ret = lfsring_cursor_peek(&rbuf, &cursor, object, sizeof(object));
+  assert(ret == sizeof(object));
+  for (unsigned int j = 0; j < sizeof(object); j++) {
+    assert(object[j] == (uint8_t) (5 + j));
+  }
+  assert(get_file_size(fs, path) == 224);
+
+  // The capacity is persisted.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(rbuf.capacity == 224);
+
+  // A drained ring buffer does not occupy any blocks.
+  take_resize_objects(&rbuf, 4, 13);
+  assert(rbuf.capacity == 0);
+  assert(get_file_size(fs, path) == 0);
+
+  // The file never grows beyond the file size, even when overwriting data.
+  append_resize_objects(&rbuf, 0, 100);
+  assert(rbuf.capacity == 1000);
+  assert(get_file_size(fs, path) <= 1000);
+  take_resize_objects(&rbuf, 100 - 1000 / 14, 100);
+  assert(get_file_size(fs, path) == 0);
+
+  // The elastic flag is part of the configuration that must match.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  config.elastic = false;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // An empty elastic ring buffer in stream mode has no capacity at all.
+  config.mode = LFSRING_MODE_STREAM;
+  config.elastic = true;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(rbuf.capacity == 0);
+  uint8_t buffer[8];
+  lfs_ssize_t n = lfsring_peek(&rbuf, buffer, sizeof(buffer));
+  assert(n == 0);
+  n = lfsring_take(&rbuf, buffer, sizeof(buffer));
+  assert(n == 0);
+  err = lfsring_append(&rbuf, buffer, 0, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, "abc", 3, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  n = lfsring_take(&rbuf, buffer, sizeof(buffer));
+  assert(n == 3 && memcmp(buffer, "abc", 3) == 0);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_group(lfs_t* fs) {
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 100
+  };
+
+  lfsring_t logs, metrics;
+  int err = lfsring_open(&logs, fs, "logs.cb", &config);
+  assert(err == 0);
+  err = lfsring_open(&metrics, fs, "metrics.cb", &config);
+  assert(err == 0);
+
+  lfsring_group_t group;
+  lfsring_group_init(&group, 100);
+  lfsring_group_add(&group, &logs, 28, 1);
+  lfsring_group_add(&group, &metrics, 0, 10);
+
+  // Each object occupies 14 bytes.
+  uint8_t data[10] = { 0 };
+  for (unsigned int i = 0; i < 5; i++) {
+    err = lfsring_append(&logs, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  assert(lfsring_group_used_bytes(&group) == 70);
+  assert(lfsring_free_bytes(&logs) == 30);
+  assert(lfsring_free_bytes(&metrics) == 30);
+
+  // Without LFSRING_OVERWRITE, the budget cannot be exceeded.
+  for (unsigned int i = 0; i < 2; i++) {
+    err = lfsring_append(&metrics, data, sizeof(data), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  err = lfsring_append(&metrics, data, sizeof(data), LFSRING_NO_OVERWRITE);
+  assert(err == LFS_ERR_NOSPC);
+
+  // With LFSRING_OVERWRITE, objects of the ring buffer with the lower weight are
+  // discarded, but only until it reaches its minimum size.
+  err = lfsring_append(&metrics, data, sizeof(data), LFSRING_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&logs) == 4);
+  assert(lfsring_count(&metrics) == 3);
+  for (unsigned int i = 0; i < 4; i++) {
+    err = lfsring_append(&metrics, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  assert(lfsring_count(&logs) == 2);
+  assert(lfsring_count(&metrics) == 5);
+  assert(lfsring_group_used_bytes(&group) == 98);
+
+  // The ring buffer with the lower weight only discards its own objects.
+  err = lfsring_append(&logs, data, sizeof(data), LFSRING_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&logs) == 2);
+  assert(lfsring_count(&metrics) == 5);
+
+  // A larger budget leaves room for both ring buffers.
+  group.budget = 200;
+  err = lfsring_append(&logs, data, sizeof(data), LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&logs) == 3);
+
+  // Closing a ring buffer removes it from its group.
+  err = lfsring_close(&logs);
+  assert(err == 0);
+  assert(lfsring_group_used_bytes(&group) == 70);
+  lfsring_group_remove(&metrics);
+  assert(group.rings == NULL);
+  err = lfsring_close(&metrics);
+  assert(err == 0);
+
+  err = lfs_remove(fs, "logs.cb");
+  assert(err == 0);
+  err = lfs_remove(fs, "metrics.cb");
+  assert(err == 0);
+}
+
+static void test_dual_handle(lfs_t* fs) {
+  const char* path = "dual.cb";
+
+  uint8_t read_buffer[LFS_CACHE_SIZE];
+  lfsring_config_t config = {
+    .read_buffer = read_buffer,
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 300,
+    .elastic = true
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Interleaved appends and takes, which grow the file, wrap around, and drain
+  // the ring buffer.
+  uint32_t next_append = 0, next_take = 0;
+  for (unsigned int round = 0; round < 50; round++) {
+    for (unsigned int i = 0; i < round % 7; i++) {
+      uint32_t data[3] = { next_append, next_append + 1, next_append + 2 };
+      err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_NO_OVERWRITE);
+      if (err == LFS_ERR_NOSPC) {
+        break;
+      }
+      assert(err == 0);
+      next_append++;
+    }
+    for (unsigned int i = 0; i < round % 5 && next_take < next_append; i++) {
+      uint32_t data[3];
+      lfs_ssize_t size = lfsring_take(&rbuf, data, sizeof(data));
+      assert(size == sizeof(data));
+      assert(data[0] == next_take && data[2] == next_take + 2);
+      next_take++;
+    }
+  }
+  assert(rbuf.read_file_open);
+
+  // Committing new data closes the reader handle because littlefs might reuse
+  // the blocks that it refers to.
+  uint32_t data[3] = { next_append, next_append + 1, next_append + 2 };
+  err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+  assert(err == 0);
+  next_append++;
+  assert(!rbuf.read_file_open);
+  lfs_ssize_t size = lfsring_take(&rbuf, data, sizeof(data));
+  assert(size == sizeof(data));
+  assert(data[0] == next_take);
+  next_take++;
+  assert(rbuf.read_file_open);
+
+  // Data that has not been committed yet is read through the writer handle.
+  rbuf.sync_policy = LFSRING_SYNC_MANUAL;
+  data[0] = next_append;
+  data[1] = next_append + 1;
+  data[2] = next_append + 2;
+  err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+  assert(err == 0);
+  next_append++;
+  while (next_take < next_append) {
+    lfs_ssize_t size = lfsring_take(&rbuf, data, sizeof(data));
+    assert(size == sizeof(data));
+    assert(data[0] == next_take);
+    next_take++;
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_wrap_free(lfs_t* fs) {
+  const char* path = "wrapfree.cb";
+
+  lfs_off_t index[4];
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_STREAM,
+    .file_size = 100,
+    .wrap_free = true,
+    .index_buffer = index,
+    .index_size = 4
+  };
+
+  // Only object mode supports wrap-free placement.
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.mode = LFSRING_MODE_OBJECT;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Seven objects occupy 98 bytes, so the next object is preceded by two bytes
+  // of implicit padding.
+  uint8_t data[40];
+  for (uint8_t i = 0; i < 7; i++) {
+    memset(data, i, 10);
+    err = lfsring_append(&rbuf, data, 10, LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  memset(data, 7, 10);
+  err = lfsring_append(&rbuf, data, 10, LFSRING_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 7);
+  assert(lfsring_used_bytes(&rbuf) == 100);
+
+  // The third object in the batch does not fit before the end of the file,
+  // which is marked with a padding marker instead.
+  lfsring_object_t objects[3] = { { data, 30 }, { data, 36 }, { data, 10 } };
+  memset(data, 8, sizeof(data));
+  lfs_ssize_t n = lfsring_append_batch(&rbuf, objects, 3, LFSRING_OVERWRITE);
+  assert(n == 3);
+  assert(lfsring_count(&rbuf) == 3);
+  assert(lfsring_used_bytes(&rbuf) == 34 + 40 + 12 + 14);
+
+  // Readers skip the padding.
+  lfsring_cursor_t cursor;
+  err = lfsring_cursor_init(&rbuf, &cursor);
+  assert(err == 0);
+  lfs_size_t n_cursor = 0;
+  while (lfsring_cursor_size(&rbuf, &cursor) >= 0) {
+    err = lfsring_cursor_next(&rbuf, &cursor);
+    assert(err == 0);
+    n_cursor++;
+  }
+  assert(n_cursor == (lfs_size_t) lfsring_count(&rbuf));
+
+  uint8_t expected = 0xff;
+  while (!lfsring_is_empty(&rbuf)) {
+    n = lfsring_take(&rbuf, data, sizeof(data));
+    assert(n == 10 || n == 30 || n == 36);
+    assert(expected == 0xff || data[0] >= expected);
+    expected = data[0];
+    for (lfs_ssize_t i = 1; i < n; i++) {
+      assert(data[i] == data[0]);
+    }
+  }
+  assert(expected == 8);
+
+  // The option is stored in the metadata.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  config.wrap_free = false;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.file_size = 0;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(rbuf.wrap_free);
+
+  // Objects of various sizes are never split.
+  for (unsigned int i = 0; i < 200; i++) {
+    memset(data, i, sizeof(data));
+    err = lfsring_append(&rbuf, data, i % 31, LFSRING_OVERWRITE);
+    assert(err == 0);
+    if (i % 3 == 0) {
+      n = lfsring_take(&rbuf, data, sizeof(data));
+      assert(n >= 0);
+      for (lfs_ssize_t j = 1; j < n; j++) {
+        assert(data[j] == data[0]);
+      }
+    }
+  }
+
+#ifdef LFSRING_YES_STATS
+  lfsring_stats_t stats;
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.bytes_padded != 0);
+  assert(stats.rewinds == 0);
+#endif
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // Padding does not count against the capacity if the ring buffer is empty,
+  // or if the object overwrites all existing data including the padding.
+  config.file_size = 100;
+  config.wrap_free = true;
+  uint8_t large[56];
+  for (unsigned int i = 0; i < 3; i++) {
+    err = lfsring_open(&rbuf, fs, path, &config);
+    assert(err == 0);
+    memset(data, 1, sizeof(data));
+    err = lfsring_append(&rbuf, data, 40, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+    err = lfsring_append(&rbuf, data, 2, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+    if (i < 2) {
+      err = lfsring_drop(&rbuf, 2);
+      assert(err == 0);
+    }
+    memset(large, 2, sizeof(large));
+    err = lfsring_append(&rbuf, large, sizeof(large),
+                         (i == 0) ? LFSRING_NO_OVERWRITE : LFSRING_OVERWRITE);
+    assert(err == 0);
+    assert(lfsring_count(&rbuf) == 1);
+    assert(lfsring_used_bytes(&rbuf) == 60);
+    memset(large, 0, sizeof(large));
+    n = lfsring_take(&rbuf, large, sizeof(large));
+    assert(n == sizeof(large));
+    for (unsigned int j = 0; j < sizeof(large); j++) {
+      assert(large[j] == 2);
+    }
+    err = lfsring_close(&rbuf);
+    assert(err == 0);
+    err = lfs_remove(fs, path);
+    assert(err == 0);
+  }
+
+  // Resizing retains the padding at the end of the file even though only its
+  // marker has been written.
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  for (uint8_t i = 0; i < 4; i++) {
+    memset(data, i, sizeof(data));
+    err = lfsring_append(&rbuf, data, 5 + 7 * i, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  err = lfsring_drop(&rbuf, 1);
+  assert(err == 0);
+  memset(data, 4, sizeof(data));
+  err = lfsring_append(&rbuf, data, 33, LFSRING_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_count(&rbuf) == 2);
+  assert(get_file_size(fs, path) < 100);
+  for (unsigned int i = 0; i < 2; i++) {
+    err = lfsring_resize(&rbuf, (i == 0) ? 104 : 96);
+    assert(err == 0);
+    lfsring_cursor_t resized;
+    err = lfsring_cursor_init(&rbuf, &resized);
+    assert(err == 0);
+    for (uint8_t j = 3; j <= 4; j++) {
+      n = lfsring_cursor_peek(&rbuf, &resized, data, sizeof(data));
+      assert(n == 5 + 7 * j);
+      for (lfs_ssize_t k = 0; k < n; k++) {
+        assert(data[k] == j);
+      }
+      err = lfsring_cursor_next(&rbuf, &resized);
+      assert(err == 0);
+    }
+  }
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // A batch that only fits without padding discards all older objects and is
+  // written at the beginning of the file instead of dropping newer objects.
+  config.file_size = 66;
+  config.checksums = true;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  memset(data, 1, sizeof(data));
+  err = lfsring_append(&rbuf, data, 16, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  uint8_t batch_data[2][26];
+  memset(batch_data[0], 2, sizeof(batch_data[0]));
+  memset(batch_data[1], 3, sizeof(batch_data[1]));
+  lfsring_object_t batch[2] = { { batch_data[0], 9 }, { batch_data[1], 26 } };
+  n = lfsring_append_batch(&rbuf, batch, 2, LFSRING_OVERWRITE);
+  assert(n == 2);
+  assert(lfsring_count(&rbuf) == 2);
+  assert(lfsring_used_bytes(&rbuf) == 17 + 34);
+  for (unsigned int i = 0; i < 2; i++) {
+    n = lfsring_take(&rbuf, data, sizeof(data));
+    assert(n == (lfs_ssize_t) batch[i].size);
+    assert(memcmp(data, batch_data[i], batch[i].size) == 0);
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  // The same applies if leading objects of the batch are discarded.
+  err = lfsring_append(&rbuf, data, 16, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  lfsring_object_t long_batch[3] = { batch[1], batch[0], batch[1] };
+  n = lfsring_append_batch(&rbuf, long_batch, 3, LFSRING_OVERWRITE);
+  assert(n == 3);
+  assert(lfsring_count(&rbuf) == 2);
+  for (unsigned int i = 0; i < 2; i++) {
+    n = lfsring_take(&rbuf, data, sizeof(data));
+    assert(n == (lfs_ssize_t) batch[i].size);
+    assert(memcmp(data, batch_data[i], batch[i].size) == 0);
+  }
+  assert(lfsring_is_empty(&rbuf));
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+static void test_varint_headers(lfs_t* fs) {
+  const char* path = "varint.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_FIXED,
+    .record_size = 4,
+    .file_size = 300,
+    .varint_headers = true
+  };
+
+  // Only object mode supports variable-length headers.
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.mode = LFSRING_MODE_OBJECT;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Objects of up to 126 bytes have a one-byte header, larger objects have a
+  // two-byte header.
+  uint8_t data[200];
+  memset(data, 0, sizeof(data));
+  err = lfsring_append(&rbuf, data, 10, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, data, 126, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  err = lfsring_append(&rbuf, data, 127, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_used_bytes(&rbuf) == 11 + 127 + 129);
+  lfs_ssize_t n = lfsring_take(&rbuf, data, sizeof(data));
+  assert(n == 10);
+  n = lfsring_take(&rbuf, data, sizeof(data));
+  assert(n == 126);
+
+  // The encoding is stored in the metadata.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  config.varint_headers = false;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.file_size = 0;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  assert(rbuf.varint_headers);
+  n = lfsring_take(&rbuf, data, sizeof(data));
+  assert(n == 127);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // Headers that wrap around the end of the file, and padding markers in
+  // wrap-free mode.
+  lfs_off_t index[4];
+  config.file_size = 300;
+  config.varint_headers = true;
+  config.index_buffer = index;
+  config.index_size = 4;
+  for (int wrap_free = 0; wrap_free <= 1; wrap_free++) {
+    config.wrap_free = wrap_free;
+    err = lfsring_open(&rbuf, fs, path, &config);
+    assert(err == 0);
+
+    for (unsigned int i = 0; i < 300; i++) {
+      lfs_size_t size = (i * 37) % 150;
+      memset(data, i, size);
+      err = lfsring_append(&rbuf, data, size, LFSRING_OVERWRITE);
+      assert(err == 0);
+      if (i % 4 == 0) {
+        n = lfsring_take(&rbuf, data, sizeof(data));
+        assert(n >= 0);
+        for (lfs_ssize_t j = 1; j < n; j++) {
+          assert(data[j] == data[0]);
+        }
+      }
+    }
+
+    lfs_ssize_t count = lfsring_count(&rbuf);
+    assert(count > 0);
+    err = lfsring_drop(&rbuf, count - 1);
+    assert(err == 0);
+    n = lfsring_take(&rbuf, data, sizeof(data));
+    assert(n == (299 * 37) % 150);
+    assert(data[0] == (uint8_t) 299);
+    assert(lfsring_is_empty(&rbuf));
+
+    err = lfsring_close(&rbuf);
+    assert(err == 0);
+    err = lfs_remove(fs, path);
+    assert(err == 0);
+  }
+}
+
+// Overwrites a single byte of a file.
+static void corrupt_file(lfs_t* fs, const char* path, lfs_off_t off) {
+  lfs_file_t file;
+  int err = lfs_file_open(fs, &file, path, LFS_O_RDWR);
+  assert(err == 0);
+  lfs_soff_t pos = lfs_file_seek(fs, &file, off, LFS_SEEK_SET);
+  assert(pos == (lfs_soff_t) off);
+  uint8_t byte;
+  lfs_ssize_t n = lfs_file_read(fs, &file, &byte, 1);
+  assert(n == 1);
+  byte ^= 0x01;
+  pos = lfs_file_seek(fs, &file, off, LFS_SEEK_SET);
+  assert(pos == (lfs_soff_t) off);
+  n = lfs_file_write(fs, &file, &byte, 1);
+  assert(n == 1);
+  err = lfs_file_close(fs, &file);
+  assert(err == 0);
+}
+
+static void test_checksums(lfs_t* fs) {
+  const char* path = "checksums.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_STREAM,
+    .file_size = 200,
+    .checksums = true
+  };
+
+  // Only object mode supports checksums.
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  config.mode = LFSRING_MODE_OBJECT;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // The checksum follows the size of the object.
+  err = lfsring_append(&rbuf, "123456789", 9, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  assert(lfsring_used_bytes(&rbuf) == 4 + 4 + 9);
+
+  lfs_file_t file;
+  err = lfs_file_open(fs, &file, path, LFS_O_RDONLY);
+  assert(err == 0);
+  uint8_t header[8];
+  lfs_ssize_t n = lfs_file_read(fs, &file, header, sizeof(header));
+  assert(n == sizeof(header));
+  err = lfs_file_close(fs, &file);
+  assert(err == 0);
+  assert(header[4] == 0x83 && header[5] == 0x92 && header[6] == 0x06 && header[7] == 0xE3);
+
+  char data[100];
+  for (unsigned int i = 0; i < 5; i++) {
+    memset(data, 'a' + i, sizeof(data));
+    err = lfsring_append(&rbuf, data, 20 + i, LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  n = lfsring_take(&rbuf, data, sizeof(data));
+  assert(n == 9 && memcmp(data, "123456789", 9) == 0);
+
+  // All objects can be verified with a small buffer.
+  n = lfsring_verify(&rbuf, data, 3);
+  assert(n == 5);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Corrupt the data of the second remaining object.
+  corrupt_file(fs, path, 17 + 28 + 8 + 5);
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  n = lfsring_verify(&rbuf, data, sizeof(data));
+  assert(n == LFS_ERR_CORRUPT);
+  n = lfsring_take(&rbuf, data, sizeof(data));
+  assert(n == 20);
+  n = lfsring_peek(&rbuf, data, sizeof(data));
+  assert(n == LFS_ERR_CORRUPT);
+  lfs_size_t sizes[2];
+  n = lfsring_take_many(&rbuf, data, sizeof(data), sizes, 2);
+  assert(n == LFS_ERR_CORRUPT);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  // Verification can be disabled when reading, but not when verifying.
+  config.no_verify = true;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  n = lfsring_peek(&rbuf, data, sizeof(data));
+  assert(n == 21 && data[5] == ('b' ^ 0x01));
+  n = lfsring_verify(&rbuf, data, sizeof(data));
+  assert(n == LFS_ERR_CORRUPT);
+
+  // The option is stored in the metadata.
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  config.checksums = false;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == LFS_ERR_INVAL);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+
+  // Checksums can be combined with variable-length headers.
+  config.checksums = true;
+  config.no_verify = false;
+  config.varint_headers = true;
+  config.wrap_free = true;
+  err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+  for (unsigned int i = 0; i < 100; i++) {
+    memset(data, i, sizeof(data));
+    err = lfsring_append(&rbuf, data, i % 50, LFSRING_OVERWRITE);
+    assert(err == 0);
+    if (i % 3 == 0) {
+      n = lfsring_take(&rbuf, data, sizeof(data));
+      assert(n >= 0);
+    }
+  }
+  n = lfsring_verify(&rbuf, data, 7);
+  assert(n == lfsring_count(&rbuf));
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+
+#ifdef LFSRING_YES_STATS
+static void test_stats(lfs_t* fs) {
+  const char* path = "stats.cb";
+
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 110
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  lfsring_stats_t stats;
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.bytes_appended == 0 && stats.syncs == 0);
+
+  // Each object occupies 24 bytes, so only four objects fit into the file.
+  uint8_t data[20] = { 0 };
+  for (unsigned int i = 0; i < 6; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.bytes_appended == 6 * sizeof(data));
+  assert(stats.objects_appended == 6);
+  assert(stats.objects_overwritten == 2);
+  assert(stats.bytes_overwritten == 2 * (4 + sizeof(data)));
+  assert(stats.header_reads == 2);
+  assert(stats.syncs == 6);
+
+  // The data of the fifth object wraps around the end of the file.
+  assert(stats.rewinds == 1);
+
+  lfsring_reset_stats(&rbuf);
+  lfs_ssize_t ret = lfsring_take(&rbuf, data, sizeof(data));
+  assert(ret == sizeof(data));
+  err = lfsring_drop(&rbuf, 2);
+  assert(err == 0);
+
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.bytes_appended == 0);
+  assert(stats.bytes_read == sizeof(data));
+  assert(stats.objects_consumed == 3);
+  assert(stats.bytes_consumed == 3 * (4 + sizeof(data)));
+  assert(stats.syncs == 2);
+
+  // Errors are counted by class.
+  ret = lfsring_take(&rbuf, data, sizeof(data) - 1);
+  assert(ret == LFS_ERR_NOMEM);
+  err = lfsring_drop(&rbuf, 2);
+  assert(err == LFS_ERR_INVAL);
+  uint8_t too_large[120] = { 0 };
+  err = lfsring_append(&rbuf, too_large, sizeof(too_large), LFSRING_OVERWRITE);
+  assert(err == LFS_ERR_NOSPC);
+
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.errors[LFSRING_ERROR_NOMEM] == 1);
+  assert(stats.errors[LFSRING_ERROR_INVAL] == 1);
+  assert(stats.errors[LFSRING_ERROR_NOSPC] == 1);
+  assert(stats.errors[LFSRING_ERROR_IO] == 0);
+
+  // Sequential appends and takes only seek when switching between them.
+  lfsring_reset_stats(&rbuf);
+  for (unsigned int i = 0; i < 3; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_NO_OVERWRITE);
+    assert(err == 0);
+  }
+  for (unsigned int i = 0; i < 4; i++) {
+    ret = lfsring_take(&rbuf, data, sizeof(data));
+    assert(ret == sizeof(data));
+  }
+  lfsring_get_stats(&rbuf, &stats);
+  assert(stats.seeks == 2);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+#endif
+
+#ifdef LFSRING_YES_HISTOGRAMS
+// A clock that advances by five ticks whenever it is read.
+static uint32_t test_clock(void* ctx) {
+  uint32_t* now = ctx;
+  return *now += 5;
+}
+
+static uint32_t histogram_total(const lfsring_histogram_t* histogram) {
+  uint32_t total = 0;
+  for (unsigned int i = 0; i < LFSRING_HISTOGRAM_BUCKETS; i++) {
+    total += histogram->count[i];
+  }
+  return total;
+}
+
+static void test_histograms(lfs_t* fs) {
+  const char* path = "histograms.cb";
+
+  uint32_t now = UINT32_MAX - 7;
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 100,
+    .clock = test_clock,
+    .clock_ctx = &now
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // Only four objects fit into the file, so the remaining appends overwrite.
+  uint8_t data[20] = { 0 };
+  for (unsigned int i = 0; i < 7; i++) {
+    err = lfsring_append(&rbuf, data, sizeof(data), LFSRING_OVERWRITE);
+    assert(err == 0);
+  }
+  lfs_ssize_t ret = lfsring_peek(&rbuf, data, sizeof(data));
+  assert(ret == sizeof(data));
+  ret = lfsring_take(&rbuf, data, sizeof(data));
+  assert(ret == sizeof(data));
+  err = lfsring_drop(&rbuf, 1);
+  assert(err == 0);
+
+  lfsring_histograms_t histograms;
+  lfsring_get_histograms(&rbuf, &histograms);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_OPEN]) == 1);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_APPEND]) == 4);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_APPEND_OVERWRITE]) == 3);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_PEEK]) == 1);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_TAKE]) == 1);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_DROP]) == 1);
+
+  // Each call took five ticks, even though the clock wrapped around.
+  assert(histograms.ops[LFSRING_OP_OPEN].count[3] == 1);
+  assert(histograms.ops[LFSRING_OP_APPEND].count[3] == 4);
+  assert(histograms.ops[LFSRING_OP_APPEND].max == 5);
+
+  lfsring_reset_histograms(&rbuf);
+  lfsring_get_histograms(&rbuf, &histograms);
+  assert(histogram_total(&histograms.ops[LFSRING_OP_APPEND]) == 0);
+
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+#endif
+
+#ifdef LFSRING_YES_EVENTS
+#define MAX_EVENTS 64
+
+struct event_log {
+  lfsring_event_t events[MAX_EVENTS];
+  unsigned int n_events;
+  uint32_t now;
+};
+
+static uint32_t event_clock(void* ctx) {
+  struct event_log* log = ctx;
+  return log->now++;
+}
+
+static void event_cb(void* ctx, const lfsring_event_t* event) {
+  struct event_log* log = ctx;
+  assert(log->n_events < MAX_EVENTS);
+  log->events[log->n_events++] = *event;
+}
+
+// Checks that begin and end events are properly nested and that the names of
+// the top-level events match the given public functions.
+static void check_events(const struct event_log* log, const void* ring,
+                         const char* const* calls, unsigned int n_calls) {
+  const char* stack[8];
+  unsigned int depth = 0, n = 0;
+  for (unsigned int i = 0; i < log->n_events; i++) {
+    const lfsring_event_t* event = &log->events[i];
+    assert(event->ring == ring);
+    assert(i == 0 || event->time > log->events[i - 1].time);
+    if (event->type == LFSRING_EVENT_BEGIN) {
+      assert(depth < 8);
+      if (depth == 0) {
+        assert(n < n_calls && strcmp(event->name, calls[n++]) == 0);
+      }
+      stack[depth++] = event->name;
+    } else {
+      assert(depth > 0 && strcmp(stack[--depth], event->name) == 0);
+    }
+  }
+  assert(depth == 0);
+  assert(n == n_calls);
+}
+
+// Returns the index of the first event of the given type and name at or after
+// the given index, or n_events if there is none.
+static unsigned int find_event(const struct event_log* log, unsigned int start,
+                               enum lfsring_event_type type, const char* name) {
+  while (start < log->n_events && (log->events[start].type != type ||
+                                   strcmp(log->events[start].name, name) != 0)) {
+    start++;
+  }
+  return start;
+}
+
+static void test_events(lfs_t* fs) {
+  const char* path = "events.cb";
+
+  struct event_log log = { .n_events = 0, .now = 0 };
+  lfsring_config_t config = {
+    .attr_metadata = LFSRING_DEFAULT_ATTR,
+    .mode = LFSRING_MODE_OBJECT,
+    .file_size = 40,
+    .clock = event_clock,
+    .clock_ctx = &log,
+    .event_cb = event_cb,
+    .event_ctx = &log
+  };
+
+  lfsring_t rbuf;
+  int err = lfsring_open(&rbuf, fs, path, &config);
+  assert(err == 0);
+
+  // The second append needs to overwrite the first object.
+  uint8_t data[30] = { 0 };
+  err = lfsring_append(&rbuf, data, 20, LFSRING_NO_OVERWRITE);
+  assert(err == 0);
+  log.n_events = 0;
+  err = lfsring_append(&rbuf, data, 20, LFSRING_OVERWRITE);
+  assert(err == 0);
+
+  static const char* const append_calls[] = { "lfsring_append" };
+  check_events(&log, &rbuf, append_calls, 1);
+  assert(log.events[0].value == 20);
+  assert(log.events[log.n_events - 1].value == 0);
+
+  // The phases of an overwriting append occur in this order.
+  unsigned int i = find_event(&log, 0, LFSRING_EVENT_BEGIN, "get_overlap_size");
+  assert(i < log.n_events && log.events[i].value == 8);
+  i = find_event(&log, i, LFSRING_EVENT_END, "get_overlap_size");
+  assert(i < log.n_events && log.events[i].value == 24);
+  i = find_event(&log, i, LFSRING_EVENT_BEGIN, "do_write");
+  assert(i < log.n_events);
+  i = find_event(&log, i, LFSRING_EVENT_BEGIN, "advance_read_position");
+  assert(i < log.n_events && log.events[i].value == 24);
+  i = find_event(&log, i, LFSRING_EVENT_BEGIN, "advance_write_position");
+  assert(i < log.n_events && log.events[i].value == 24);
+  i = find_event(&log, i, LFSRING_EVENT_BEGIN, "do_sync");
+  assert(i < log.n_events);
+
+  // Errors are reported as the values of end events.
+  log.n_events = 0;
+  lfs_ssize_t ret = lfsring_peek(&rbuf, data, 10);
+  assert(ret == LFS_ERR_NOMEM);
+  ret = lfsring_take(&rbuf, data, sizeof(data));
+  assert(ret == 20);
+  err = lfsring_close(&rbuf);
+  assert(err == 0);
+
+  static const char* const read_calls[] = { "lfsring_peek", "lfsring_take", "lfsring_close" };
+  check_events(&log, &rbuf, read_calls, 3);
+  assert(log.events[find_event(&log, 0, LFSRING_EVENT_END, "lfsring_peek")].value == LFS_ERR_NOMEM);
+  assert(find_event(&log, 0, LFSRING_EVENT_BEGIN, "do_read") < log.n_events);
+
+  err = lfs_remove(fs, path);
+  assert(err == 0);
+}
+#endif
+
 static void run_tests_with_config(struct lfs_config* fs_config) {
   lfs_t fs;
   int err = lfs_format(&fs, fs_config);
@@ -345,6 +2612,33 @@ static void run_tests_with_config(struct lfs_config* fs_config) {
 
   test_stream_mode(&fs);
   test_object_mode(&fs);
+  test_append_batch(&fs);
+  test_sync_policy(&fs);
+  test_take_many(&fs);
+  test_visit(&fs);
+  test_cursor(&fs);
+  test_index(&fs);
+  test_fixed_mode(&fs);
+  test_segmented(&fs);
+  test_io_budget(&fs);
+  test_count(&fs);
+  test_header(&fs);
+  test_resize(&fs);
+  test_elastic(&fs);
+  test_group(&fs);
+  test_dual_handle(&fs);
+  test_wrap_free(&fs);
+  test_varint_headers(&fs);
+  test_checksums(&fs);
+#ifdef LFSRING_YES_STATS
+  test_stats(&fs);
+#endif
+#ifdef LFSRING_YES_HISTOGRAMS
+  test_histograms(&fs);
+#endif
+#ifdef LFSRING_YES_EVENTS
+  test_events(&fs);
+#endif
 
   err = lfs_unmount(&fs);
   assert(err == 0);
@@ -389,9 +2683,13 @@ int main(void) {
 #endif
   assert(err == 0);
 
+  // Count block device operations such that tests can check I/O budgets.
+  lfs_countbd_t countbd;
+  lfs_countbd_wrap(&countbd, &fs_config);
+
   run_tests_with_config(&fs_config);
 
-  err = lfs_rambd_destroy(&fs_config);
+  err = lfs_rambd_destroy(&countbd.bd_config);
   assert(err == 0);
 
   return 0;